@@ -110,6 +110,18 @@ typedef struct {
   float threshold;
   int minBits;
   int maxBits;
+  int sortType;
+  int threads;
+  uint64_t memLimit;
+  int engine;
+  int compress;
+  int sortedInput;
+  int inputMethod;
+  int outputOrder;
+  int outputFormat;
+  char *setName;
+  int exact;
+  uint64_t maxElem;
 } Config_t;
 
 #endif	/* end of COMMON_H */
@@ -143,6 +143,10 @@
 # include <paths.h>
 #endif
 
+#ifdef HAVE_PTHREAD_H
+# include <pthread.h>
+#endif
+
 #ifdef HAVE_SIGNAL_H
 # include <signal.h>
 #endif
@@ -189,6 +193,10 @@
 # include <sys/ioctl.h>
 #endif
 
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
+
 #ifdef HAVE_SYS_NDIR_H
 # include <sys/ndir.h>
 #endif
@@ -0,0 +1,514 @@
+/*****
+ *
+ * Description: IPv4 address bitmaps
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "bitmap.h"
+
+#ifdef HAVE_SIMD_POPCOUNT
+#include <immintrin.h>
+#endif
+
+/****
+ *
+ * local variables
+ *
+ ****/
+
+PRIVATE uint64_t popcountScalar(const uint64_t *words, size_t count);
+PRIVATE uint64_t (*popcountWords)(const uint64_t *words, size_t count) = popcountScalar;
+
+/****
+ *
+ * external variables
+ *
+ ****/
+
+extern Config_t *config;
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * popcount kernels
+ *
+ ****/
+
+PRIVATE inline uint64_t popcount64(uint64_t x)
+{
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+
+  return ((x * 0x0101010101010101ULL) >> 56);
+}
+
+PRIVATE uint64_t popcountScalar(const uint64_t *words, size_t count)
+{
+  uint64_t total = 0;
+
+  for (size_t i = 0; i < count; ++i)
+    total += popcount64(words[i]);
+
+  return (total);
+}
+
+#ifdef HAVE_SIMD_POPCOUNT
+__attribute__((target("popcnt"))) PRIVATE uint64_t popcountPopcnt(const uint64_t *words, size_t count)
+{
+  uint64_t total = 0;
+
+  for (size_t i = 0; i < count; ++i)
+    total += (uint64_t)__builtin_popcountll(words[i]);
+
+  return (total);
+}
+
+/* nibble lookup with pshufb, byte counts summed with psadbw */
+__attribute__((target("avx2,popcnt"))) PRIVATE uint64_t popcountAvx2(const uint64_t *words, size_t count)
+{
+  const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                          0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i lowMask = _mm256_set1_epi8(0x0f);
+  __m256i acc = _mm256_setzero_si256(), v, cnt;
+  uint64_t total;
+  size_t i = 0;
+
+  if (count < 16)
+    return (popcountPopcnt(words, count));
+
+  for (; i + 4 <= count; i += 4)
+  {
+    v = _mm256_loadu_si256((const __m256i *)(words + i));
+    cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, _mm256_and_si256(v, lowMask)),
+                          _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), lowMask)));
+    acc = _mm256_add_epi64(acc, _mm256_sad_epu8(cnt, _mm256_setzero_si256()));
+  }
+
+  total = (uint64_t)_mm256_extract_epi64(acc, 0) + (uint64_t)_mm256_extract_epi64(acc, 1) +
+          (uint64_t)_mm256_extract_epi64(acc, 2) + (uint64_t)_mm256_extract_epi64(acc, 3);
+
+  return (total + popcountPopcnt(words + i, count - i));
+}
+#endif
+
+/****
+ *
+ * select the fastest popcount kernel for this cpu
+ *
+ ****/
+
+void initPopcount(void)
+{
+#ifdef HAVE_SIMD_POPCOUNT
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+    popcountWords = popcountAvx2;
+  else if (__builtin_cpu_supports("popcnt"))
+    popcountWords = popcountPopcnt;
+#endif
+}
+
+/****
+ *
+ * number of set bits in count words
+ *
+ ****/
+
+uint64_t bitmapPopcount(const uint64_t *words, size_t count)
+{
+  return ((*popcountWords)(words, count));
+}
+
+/****
+ *
+ * allocate the bitmap
+ *
+ * flat bitmaps are mapped so pages that are never written are never
+ * backed, sparse bitmaps start with an empty /16 directory.
+ *
+ ****/
+
+int initBitmap(struct bitmap_s *bitmap, int sparse)
+{
+  XMEMSET(bitmap, 0, sizeof(struct bitmap_s));
+  bitmap->sparse = sparse;
+
+  initPopcount();
+
+  if (sparse)
+  {
+    if ((bitmap->leaves = (uint64_t **)XMALLOC(BITMAP_CHUNKS * sizeof(uint64_t *))) EQ NULL)
+    {
+      fprintf(stderr, "ERR - Unable to allocate memory for bitmap directory\n");
+      return (FAILED);
+    }
+    return (TRUE);
+  }
+
+#if defined(HAVE_MMAP) && defined(MAP_ANONYMOUS)
+  if ((bitmap->words = mmap(NULL, BITMAP_WORDS * sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) != MAP_FAILED)
+  {
+    bitmap->mapped = TRUE;
+    return (TRUE);
+  }
+  bitmap->words = NULL;
+#endif
+
+  if ((bitmap->words = (uint64_t *)XMALLOC(BITMAP_WORDS * sizeof(uint64_t))) EQ NULL)
+  {
+    fprintf(stderr, "ERR - Unable to allocate memory for address bitmap\n");
+    return (FAILED);
+  }
+
+  return (TRUE);
+}
+
+/****
+ *
+ * words of the /16 holding addr, NULL for a sparse /16 never written
+ *
+ ****/
+
+PRIVATE inline uint64_t *chunkWords(struct bitmap_s *bitmap, uint32_t addr)
+{
+  if (bitmap->sparse)
+    return (bitmap->leaves[addr >> 16]);
+
+  return (bitmap->words + ((size_t)(addr >> 16) * BITMAP_CHUNK_WORDS));
+}
+
+/****
+ *
+ * words of the /16 holding addr, allocating a sparse leaf on first write
+ *
+ ****/
+
+PRIVATE uint64_t *touchChunk(struct bitmap_s *bitmap, uint32_t addr)
+{
+  uint32_t chunk = addr >> 16;
+
+  if (!((bitmap->touched[chunk >> 6] >> (chunk & 63)) & 1))
+  {
+    if (bitmap->sparse)
+    {
+      if ((bitmap->leaves[chunk] = (uint64_t *)XMALLOC(BITMAP_CHUNK_WORDS * sizeof(uint64_t))) EQ NULL)
+      {
+        fprintf(stderr, "ERR - Unable to allocate memory for bitmap leaf\n");
+        return (NULL);
+      }
+      bitmap->leafCount++;
+    }
+    bitmap->touched[chunk >> 6] |= (uint64_t)1 << (chunk & 63);
+  }
+
+  return (chunkWords(bitmap, addr));
+}
+
+/****
+ *
+ * add one address
+ *
+ ****/
+
+int bitmapSet(struct bitmap_s *bitmap, uint32_t addr)
+{
+  uint64_t *words;
+
+  if ((words = touchChunk(bitmap, addr)) EQ NULL)
+    return (FAILED);
+  words[(addr & 0xffff) >> 6] |= (uint64_t)1 << (addr & 63);
+
+  return (TRUE);
+}
+
+/****
+ *
+ * add every address from start to end, one /16 at a time
+ *
+ ****/
+
+int bitmapSetRange(struct bitmap_s *bitmap, uint32_t start, uint32_t end)
+{
+  uint64_t *words, headMask, tailMask;
+  uint32_t chunkEnd;
+  size_t first, last;
+
+  for (;;)
+  {
+    chunkEnd = ((start | 0xffff) < end) ? (start | 0xffff) : end;
+    if ((words = touchChunk(bitmap, start)) EQ NULL)
+      return (FAILED);
+
+    first = (start & 0xffff) >> 6;
+    last = (chunkEnd & 0xffff) >> 6;
+    headMask = ~(uint64_t)0 << (start & 63);
+    tailMask = ~(uint64_t)0 >> (63 - (chunkEnd & 63));
+
+    if (first EQ last)
+      words[first] |= headMask & tailMask;
+    else
+    {
+      words[first] |= headMask;
+      if (last > first + 1)
+        memset(words + first + 1, 0xff, (last - first - 1) * sizeof(uint64_t));
+      words[last] |= tailMask;
+    }
+
+    if (chunkEnd EQ end)
+      return (TRUE);
+    start = chunkEnd + 1;
+  }
+}
+
+/****
+ *
+ * true when any /16 in the start/len block has been written to
+ *
+ ****/
+
+PRIVATE int bitmapTouched(struct bitmap_s *bitmap, uint32_t start, int len)
+{
+  uint32_t chunk = start >> 16, chunks;
+
+  if (len >= 16)
+    return ((bitmap->touched[chunk >> 6] >> (chunk & 63)) & 1);
+
+  chunks = (uint32_t)1 << (16 - len);
+  if (chunks < 64)
+    return ((bitmap->touched[chunk >> 6] >> (chunk & 63)) & (((uint64_t)1 << chunks) - 1)) != 0;
+
+  for (uint32_t i = chunk >> 6; i < (chunk + chunks) >> 6; ++i)
+    if (bitmap->touched[i])
+      return (TRUE);
+
+  return (FALSE);
+}
+
+/****
+ *
+ * number of addresses in the start/len block
+ *
+ ****/
+
+uint64_t bitmapCount(struct bitmap_s *bitmap, uint32_t start, int len)
+{
+  uint64_t bits = (uint64_t)1 << (32 - len), total = 0;
+  uint64_t *words;
+
+  if (len < 16)
+  {
+    /* blocks larger than a /16 add up their written /16s */
+    for (uint64_t chunk = start >> 16; chunk < (start >> 16) + ((uint64_t)1 << (16 - len)); ++chunk)
+      if (bitmapTouched(bitmap, (uint32_t)(chunk << 16), 16))
+        total += (*popcountWords)(chunkWords(bitmap, (uint32_t)(chunk << 16)), BITMAP_CHUNK_WORDS);
+    return (total);
+  }
+
+  if (!bitmapTouched(bitmap, start, 16))
+    return (0);
+  words = chunkWords(bitmap, start) + ((start & 0xffff) >> 6);
+
+  if (bits >= 64)
+    return ((*popcountWords)(words, (size_t)(bits >> 6)));
+
+  return (popcount64(*words & ((((uint64_t)1 << bits) - 1) << (start & 63))));
+}
+
+/****
+ *
+ * add the addresses in a block to the leftover hosts and ranges
+ *
+ ****/
+
+PRIVATE int bitmapLeftovers(struct bitmap_s *bitmap, uint32_t start, int len, struct addrVector_s *hosts, struct rangeVector_s *ranges)
+{
+  uint64_t bits = (uint64_t)1 << (32 - len), word, *words;
+  size_t first, last;
+  uint32_t base;
+
+  if (len < 16)
+  {
+    for (uint64_t chunk = start >> 16; chunk < (start >> 16) + ((uint64_t)1 << (16 - len)); ++chunk)
+      if (bitmapTouched(bitmap, (uint32_t)(chunk << 16), 16) && bitmapLeftovers(bitmap, (uint32_t)(chunk << 16), 16, hosts, ranges) EQ FAILED)
+        return (FAILED);
+    return (TRUE);
+  }
+
+  if (!bitmapTouched(bitmap, start, 16))
+    return (TRUE);
+  words = chunkWords(bitmap, start);
+  first = (start & 0xffff) >> 6;
+  last = first + ((bits >= 64) ? (size_t)(bits >> 6) : 1);
+
+  for (size_t i = first; i < last; ++i)
+  {
+    word = words[i];
+    if (bits < 64)
+      word &= (((uint64_t)1 << bits) - 1) << (start & 63);
+    base = (start & 0xffff0000) | (uint32_t)(i << 6);
+
+    if (word EQ ~(uint64_t)0)
+    {
+      if (addRangeVector(ranges, base, base + 63) EQ FAILED)
+        return (FAILED);
+      continue;
+    }
+
+    for (int bit = 0; word; ++bit, word >>= 1)
+    {
+      if (!(word & 1))
+        continue;
+      if (hosts->count EQ hosts->size && growAddrVector(hosts, hosts->count + 1) EQ FAILED)
+        return (FAILED);
+      hosts->list[hosts->count++] = base + bit;
+    }
+  }
+
+  return (TRUE);
+}
+
+/****
+ *
+ * consolidate one block whose count is already known
+ *
+ * the left half is counted and the right half is what is left, so every
+ * level only counts half of the words under it.
+ *
+ ****/
+
+PRIVATE int consolidateBitmapBlock(struct bitmap_s *bitmap, uint32_t start, int len, uint64_t count, const uint64_t minCount[], int maxBits, struct cidrVector_s *cidrs, struct addrVector_s *hosts, struct rangeVector_s *ranges)
+{
+  uint64_t left;
+
+  if (count EQ 0)
+    return (TRUE);
+
+  if (len > maxBits)
+    return (bitmapLeftovers(bitmap, start, len, hosts, ranges));
+
+  if (count >= minCount[len])
+    return (addCidrVector(cidrs, start, len));
+
+  if (len EQ maxBits)
+    return (bitmapLeftovers(bitmap, start, len, hosts, ranges));
+
+  if (count EQ ((uint64_t)1 << (32 - len)))
+  {
+    /* every block inside a full block is full */
+    for (int subLen = len + 1; subLen <= maxBits; ++subLen)
+      if (((uint64_t)1 << (32 - subLen)) >= minCount[subLen])
+      {
+        for (uint64_t b = 0; b < ((uint64_t)1 << (subLen - len)); ++b)
+          if (addCidrVector(cidrs, start + (uint32_t)(b << (32 - subLen)), subLen) EQ FAILED)
+            return (FAILED);
+        return (TRUE);
+      }
+
+    return (addRangeVector(ranges, start, start + (uint32_t)(count - 1)));
+  }
+
+  left = bitmapCount(bitmap, start, len + 1);
+  if (consolidateBitmapBlock(bitmap, start, len + 1, left, minCount, maxBits, cidrs, hosts, ranges) EQ FAILED)
+    return (FAILED);
+
+  return (consolidateBitmapBlock(bitmap, start | (0x80000000 >> len), len + 1, count - left, minCount, maxBits, cidrs, hosts, ranges));
+}
+
+/****
+ *
+ * consolidate the bitmap one /minBits block at a time
+ *
+ * kept blocks go to cidrs in address order, addresses that are not in a
+ * kept block go to hosts and ranges.  blocks with no written /16 are
+ * skipped without reading them.
+ *
+ ****/
+
+int consolidateBitmap(struct bitmap_s *bitmap, const uint64_t minCount[], int minBits, int maxBits, struct cidrVector_s *cidrs, struct addrVector_s *hosts, struct rangeVector_s *ranges)
+{
+  uint64_t blocks = (uint64_t)1 << minBits, start;
+
+  for (uint64_t b = 0; b < blocks; ++b)
+  {
+    start = b << (32 - minBits);
+    if (!bitmapTouched(bitmap, (uint32_t)start, minBits))
+      continue;
+
+    if (consolidateBitmapBlock(bitmap, (uint32_t)start, minBits, bitmapCount(bitmap, (uint32_t)start, minBits), minCount, maxBits, cidrs, hosts, ranges) EQ FAILED)
+      return (FAILED);
+  }
+
+  return (TRUE);
+}
+
+/****
+ *
+ * release the bitmap
+ *
+ ****/
+
+void freeBitmap(struct bitmap_s *bitmap)
+{
+  if (bitmap->leaves != NULL)
+  {
+    for (uint32_t chunk = 0; chunk < BITMAP_CHUNKS; ++chunk)
+      if (bitmap->leaves[chunk] != NULL)
+        XFREE(bitmap->leaves[chunk]);
+    XFREE(bitmap->leaves);
+  }
+
+  if (bitmap->words != NULL)
+  {
+#if defined(HAVE_MMAP) && defined(MAP_ANONYMOUS)
+    if (bitmap->mapped)
+      munmap(bitmap->words, BITMAP_WORDS * sizeof(uint64_t));
+    else
+#endif
+      XFREE(bitmap->words);
+  }
+
+  bitmap->words = NULL;
+  bitmap->leaves = NULL;
+  bitmap->mapped = FALSE;
+}
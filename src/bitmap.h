@@ -0,0 +1,115 @@
+/*****
+ *
+ * Description: IPv4 address bitmaps
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+#ifndef BITMAP_DOT_H
+#define BITMAP_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+#include "mem.h"
+#include "vector.h"
+#include <stdint.h>
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+#if defined(HAVE_IMMINTRIN_H) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_SIMD_POPCOUNT 1
+#endif
+
+/* one bit per address in 64 bit words, 512 MB */
+#define BITMAP_WORDS ((size_t)1 << 26)
+
+/* a /16 is 1024 words, 8 KB */
+#define BITMAP_CHUNKS 65536
+#define BITMAP_CHUNK_WORDS 1024
+
+/* one bit per /16 that has been written to */
+#define BITMAP_TOUCHED_WORDS (BITMAP_CHUNKS / 64)
+
+/****
+ *
+ * typedefs & structs
+ *
+ ****/
+
+/*
+ * flat bitmaps hold the whole space in words, sparse bitmaps allocate a
+ * /16 leaf the first time an address in it is set.
+ */
+struct bitmap_s
+{
+  uint64_t *words;
+  uint64_t **leaves;
+  uint64_t touched[BITMAP_TOUCHED_WORDS];
+  uint32_t leafCount;
+  int mapped;
+  int sparse;
+};
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+void initPopcount(void);
+uint64_t bitmapPopcount(const uint64_t *words, size_t count);
+int initBitmap(struct bitmap_s *bitmap, int sparse);
+int bitmapSet(struct bitmap_s *bitmap, uint32_t addr);
+int bitmapSetRange(struct bitmap_s *bitmap, uint32_t start, uint32_t end);
+uint64_t bitmapCount(struct bitmap_s *bitmap, uint32_t start, int len);
+int consolidateBitmap(struct bitmap_s *bitmap, const uint64_t minCount[], int minBits, int maxBits, struct cidrVector_s *cidrs, struct addrVector_s *hosts, struct rangeVector_s *ranges);
+void freeBitmap(struct bitmap_s *bitmap);
+
+#endif /* BITMAP_DOT_H */
@@ -0,0 +1,405 @@
+/*****
+ *
+ * Description: External Sort Functions
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "extsort.h"
+
+/****
+ *
+ * external variables
+ *
+ ****/
+
+extern int errno;
+extern Config_t *config;
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * create an unlinked temporary file in $TMPDIR
+ *
+ ****/
+
+FILE *createTempFile(void)
+{
+  char fName[PATH_MAX];
+  const char *tmpDir;
+  FILE *fp;
+  int fd;
+
+  if ((tmpDir = getenv("TMPDIR")) EQ NULL || *tmpDir EQ 0)
+    tmpDir = DEFAULT_TMP_DIR;
+
+  snprintf(fName, sizeof(fName), "%s/ip2cidr.XXXXXX", tmpDir);
+  if ((fd = mkstemp(fName)) EQ FAILED)
+  {
+    fprintf(stderr, "ERR - Unable to create temp file [%s] %d (%s)\n", fName, errno, strerror(errno));
+    return (NULL);
+  }
+
+  /* gone as soon as it is closed */
+  unlink(fName);
+
+  if ((fp = fdopen(fd, "w+")) EQ NULL)
+  {
+    fprintf(stderr, "ERR - Unable to open temp file %d (%s)\n", errno, strerror(errno));
+    close(fd);
+  }
+
+  return (fp);
+}
+
+/****
+ *
+ * append a sorted list to the run file as a new run
+ *
+ ****/
+
+int spillRun(struct extSort_s *ext, uint32_t *list, size_t count)
+{
+  struct runFile_s *tmpPtr;
+
+  if (ext->runCount EQ ext->runSize)
+  {
+    ext->runSize = (ext->runSize > 0) ? ext->runSize * 2 : 16;
+    if ((tmpPtr = XREALLOC(ext->runs, ext->runSize * sizeof(struct runFile_s))) EQ NULL)
+      return (FAILED);
+    ext->runs = tmpPtr;
+  }
+
+  if (ext->fp EQ NULL && (ext->fp = createTempFile()) EQ NULL)
+    return (FAILED);
+
+  if (fwrite(list, sizeof(uint32_t), count, ext->fp) != count || fflush(ext->fp) != 0)
+  {
+    fprintf(stderr, "ERR - Unable to write sorted run %d (%s)\n", errno, strerror(errno));
+    return (FAILED);
+  }
+
+  XMEMSET(&ext->runs[ext->runCount], 0, sizeof(struct runFile_s));
+  ext->runs[ext->runCount].pos = ext->fileEnd;
+  ext->fileEnd += (off_t)(count * sizeof(uint32_t));
+  ext->runs[ext->runCount++].end = ext->fileEnd;
+
+  if (config->verbose)
+    fprintf(stderr, "Spilled run [%lu] with [%lu] addresses\n", (unsigned long)ext->runCount, (unsigned long)count);
+
+  return (TRUE);
+}
+
+/****
+ *
+ * current address of a run
+ *
+ ****/
+
+#define RUN_HEAD(ext, i) ((ext)->runs[(ext)->heap[i]].buf[(ext)->runs[(ext)->heap[i]].bufPos])
+
+/****
+ *
+ * refill a run buffer, false when the run is exhausted or can not be read
+ *
+ ****/
+
+PRIVATE int fillRun(struct extSort_s *ext, struct runFile_s *run)
+{
+  size_t want, got = 0;
+  ssize_t rCount;
+
+  if (run->bufPos < run->bufCount)
+    return (TRUE);
+
+  run->bufCount = run->bufPos = 0;
+  if (run->pos >= run->end)
+    return (FALSE);
+
+  want = (size_t)(run->end - run->pos);
+  if (want > ext->bufCount * sizeof(uint32_t))
+    want = ext->bufCount * sizeof(uint32_t);
+
+  while (got < want)
+  {
+    if ((rCount = pread(fileno(ext->fp), (char *)run->buf + got, want - got, run->pos + (off_t)got)) > 0)
+      got += (size_t)rCount;
+    else if (rCount EQ FAILED && errno EQ EINTR)
+      continue;
+    else
+    {
+      /* a short run would silently drop addresses */
+      if (rCount EQ 0)
+        fprintf(stderr, "ERR - Sorted run ends early\n");
+      else
+        fprintf(stderr, "ERR - Unable to read sorted run %d (%s)\n", errno, strerror(errno));
+      ext->failed = TRUE;
+      return (FALSE);
+    }
+  }
+
+  run->pos += (off_t)got;
+  run->bufCount = got / sizeof(uint32_t);
+
+  return (TRUE);
+}
+
+/****
+ *
+ * restore heap order below position i
+ *
+ ****/
+
+PRIVATE void siftDown(struct extSort_s *ext, size_t i)
+{
+  size_t child, tmp;
+
+  while ((child = (i * 2) + 1) < ext->heapCount)
+  {
+    if (child + 1 < ext->heapCount && RUN_HEAD(ext, child + 1) < RUN_HEAD(ext, child))
+      child++;
+    if (RUN_HEAD(ext, i) <= RUN_HEAD(ext, child))
+      break;
+
+    tmp = ext->heap[i];
+    ext->heap[i] = ext->heap[child];
+    ext->heap[child] = tmp;
+    i = child;
+  }
+}
+
+/****
+ *
+ * build the merge heap over count runs starting at first
+ *
+ ****/
+
+PRIVATE void openMerge(struct extSort_s *ext, size_t first, size_t count)
+{
+  ext->heapCount = 0;
+  ext->haveLast = FALSE;
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    ext->runs[first + i].buf = ext->pool + (i * ext->bufCount);
+    ext->runs[first + i].bufCount = ext->runs[first + i].bufPos = 0;
+
+    if (fillRun(ext, &ext->runs[first + i]))
+      ext->heap[ext->heapCount++] = first + i;
+  }
+
+  for (size_t i = ext->heapCount / 2; i-- > 0;)
+    siftDown(ext, i);
+}
+
+/****
+ *
+ * append buffered addresses of a merged run to the new run file
+ *
+ ****/
+
+PRIVATE void writeMerged(struct extSort_s *ext, FILE *fp, uint32_t *buf, size_t *count, off_t *end)
+{
+  if (*count > 0 && fwrite(buf, sizeof(uint32_t), *count, fp) != *count)
+  {
+    fprintf(stderr, "ERR - Unable to write merged run %d (%s)\n", errno, strerror(errno));
+    ext->failed = TRUE;
+  }
+  *end += (off_t)(*count * sizeof(uint32_t));
+  *count = 0;
+}
+
+/****
+ *
+ * merge every fanIn runs into one, into a new run file
+ *
+ ****/
+
+PRIVATE int mergePass(struct extSort_s *ext)
+{
+  struct runFile_s *merged;
+  uint32_t outBuf[RUN_BUF_MIN], addr;
+  size_t mergedCount = 0, outCount, count;
+  off_t end = 0;
+  FILE *next;
+
+  if ((next = createTempFile()) EQ NULL)
+    return (FAILED);
+  if ((merged = (struct runFile_s *)XMALLOC(((ext->runCount + ext->fanIn - 1) / ext->fanIn) * sizeof(struct runFile_s))) EQ NULL)
+  {
+    fclose(next);
+    return (FAILED);
+  }
+
+  for (size_t first = 0; first < ext->runCount && !ext->failed; first += ext->fanIn)
+  {
+    count = (ext->runCount - first < ext->fanIn) ? ext->runCount - first : ext->fanIn;
+    openMerge(ext, first, count);
+
+    merged[mergedCount].pos = end;
+    outCount = 0;
+    while (nextMerged(ext, &addr))
+    {
+      outBuf[outCount++] = addr;
+      if (outCount EQ RUN_BUF_MIN)
+        writeMerged(ext, next, outBuf, &outCount, &end);
+    }
+    writeMerged(ext, next, outBuf, &outCount, &end);
+    merged[mergedCount++].end = end;
+  }
+
+  if (!ext->failed && fflush(next) != 0)
+  {
+    fprintf(stderr, "ERR - Unable to write merged run %d (%s)\n", errno, strerror(errno));
+    ext->failed = TRUE;
+  }
+
+  if (ext->failed)
+  {
+    fclose(next);
+    XFREE(merged);
+    return (FAILED);
+  }
+
+  fclose(ext->fp);
+  ext->fp = next;
+  ext->fileEnd = end;
+  XFREE(ext->runs);
+  ext->runs = merged;
+  ext->runCount = ext->runSize = mergedCount;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * size the merge buffers, merge down to fanIn runs and build the merge heap
+ *
+ * the buffers take the half of the memory limit the sort scratch used.
+ *
+ ****/
+
+int startMerge(struct extSort_s *ext)
+{
+  uint64_t budget = (config->memLimit > 0) ? config->memLimit / 2 : (uint64_t)MERGE_FAN_IN * RUN_BUF_COUNT * sizeof(uint32_t);
+
+  ext->fanIn = (size_t)(budget / (RUN_BUF_MIN * sizeof(uint32_t)));
+  if (ext->fanIn > MERGE_FAN_IN)
+    ext->fanIn = MERGE_FAN_IN;
+  else if (ext->fanIn < 2)
+    ext->fanIn = 2;
+  ext->bufCount = (size_t)(budget / (ext->fanIn * sizeof(uint32_t)));
+  if (ext->bufCount > RUN_BUF_COUNT)
+    ext->bufCount = RUN_BUF_COUNT;
+  else if (ext->bufCount < RUN_BUF_MIN)
+    ext->bufCount = RUN_BUF_MIN;
+
+  if ((ext->pool = (uint32_t *)XMALLOC(ext->fanIn * ext->bufCount * sizeof(uint32_t))) EQ NULL ||
+      (ext->heap = (size_t *)XMALLOC((ext->fanIn + 1) * sizeof(size_t))) EQ NULL)
+    return (FAILED);
+
+  while (ext->runCount > ext->fanIn)
+  {
+    if (config->verbose)
+      fprintf(stderr, "Merging [%lu] runs [%lu] at a time\n", (unsigned long)ext->runCount, (unsigned long)ext->fanIn);
+    if (mergePass(ext) EQ FAILED)
+      return (FAILED);
+  }
+
+  openMerge(ext, 0, ext->runCount);
+
+  return (ext->failed ? FAILED : TRUE);
+}
+
+/****
+ *
+ * next unique address from the k-way merge, false when all runs are done
+ * or one could not be read
+ *
+ ****/
+
+int nextMerged(struct extSort_s *ext, uint32_t *addr)
+{
+  struct runFile_s *run;
+  uint32_t head;
+
+  while (ext->heapCount > 0 && !ext->failed)
+  {
+    run = &ext->runs[ext->heap[0]];
+    head = run->buf[run->bufPos++];
+
+    if (!fillRun(ext, run))
+      ext->heap[0] = ext->heap[--ext->heapCount];
+    if (ext->heapCount > 0)
+      siftDown(ext, 0);
+
+    /* runs overlap, drop duplicates across them */
+    if (ext->haveLast && head EQ ext->last)
+      continue;
+
+    ext->haveLast = TRUE;
+    ext->last = *addr = head;
+    return (TRUE);
+  }
+
+  return (FALSE);
+}
+
+/****
+ *
+ * close the run file and free merge state
+ *
+ ****/
+
+void freeExtSort(struct extSort_s *ext)
+{
+  if (ext->fp != NULL)
+    fclose(ext->fp);
+  if (ext->runs != NULL)
+    XFREE(ext->runs);
+  if (ext->pool != NULL)
+    XFREE(ext->pool);
+  if (ext->heap != NULL)
+    XFREE(ext->heap);
+
+  XMEMSET(ext, 0, sizeof(struct extSort_s));
+}
@@ -0,0 +1,124 @@
+/*****
+ *
+ * Description: External Sort Headers
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+#ifndef EXTSORT_DOT_H
+#define EXTSORT_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+#include "mem.h"
+#include <stdint.h>
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+/* most runs merged at once, more runs are merged down in passes first */
+#define MERGE_FAN_IN 64
+
+/* addresses buffered per run while merging, sized to fit the memory limit */
+#define RUN_BUF_MIN 1024
+#define RUN_BUF_COUNT 16384
+
+#define DEFAULT_TMP_DIR "/tmp"
+
+/****
+ *
+ * typedefs & structs
+ *
+ ****/
+
+/* one sorted run, the addresses between pos and end of the run file */
+struct runFile_s
+{
+  off_t pos;
+  off_t end;
+  uint32_t *buf;
+  size_t bufCount;
+  size_t bufPos;
+};
+
+/*
+ * every run is written back to back in one temp file so the run count
+ * never costs descriptors.  runs are merged fanIn at a time, each through
+ * its own slice of the buffer pool.
+ */
+struct extSort_s
+{
+  FILE *fp;
+  off_t fileEnd;
+  struct runFile_s *runs;
+  size_t runCount;
+  size_t runSize;
+  uint32_t *pool;
+  size_t bufCount;
+  size_t fanIn;
+  size_t *heap;
+  size_t heapCount;
+  int failed;
+  int haveLast;
+  uint32_t last;
+};
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+FILE *createTempFile(void);
+int spillRun(struct extSort_s *ext, uint32_t *list, size_t count);
+int startMerge(struct extSort_s *ext);
+int nextMerged(struct extSort_s *ext, uint32_t *addr);
+void freeExtSort(struct extSort_s *ext);
+
+#endif /* EXTSORT_DOT_H */
@@ -0,0 +1,436 @@
+/*****
+ *
+ * Description: Input Reader Functions
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "input.h"
+
+/****
+ *
+ * external variables
+ *
+ ****/
+
+extern int errno;
+extern Config_t *config;
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * open input file, map regular files and buffer everything else
+ *
+ * with -i read or uring regular files are read instead, through io_uring
+ * when it is usable and with readahead hints otherwise.
+ *
+ ****/
+
+struct inputFile_s *openInputFile(const char *fName)
+{
+  struct inputFile_s *inFile;
+  struct stat sb;
+
+  inFile = (struct inputFile_s *)XMALLOC(sizeof(struct inputFile_s));
+
+  if (strcmp(fName, "-") EQ 0)
+    inFile->fd = STDIN_FILENO;
+  else if ((inFile->fd = open(fName, O_RDONLY)) EQ FAILED)
+  {
+    fprintf(stderr, "ERR - Unable to open file [%s] %d (%s)\n", fName, errno, strerror(errno));
+    XFREE(inFile);
+    return (NULL);
+  }
+
+  if (fstat(inFile->fd, &sb) EQ 0 && S_ISREG(sb.st_mode))
+  {
+    inFile->fileSize = sb.st_size;
+
+    /* /proc and sysfs files report no size but still have content, read them */
+    if (sb.st_size EQ 0)
+    {
+      inFile->adviseOffset = -1;
+      inFile->bufSize = INPUT_BLOCK_SIZE;
+      inFile->buf = (char *)XMALLOC(inFile->bufSize);
+      return (inFile);
+    }
+
+#ifdef HAVE_MMAP
+    /* regular files are scanned directly in the page cache */
+    if (config->inputMethod EQ INPUT_MMAP && (uint64_t)sb.st_size <= (uint64_t)SIZE_MAX &&
+        (inFile->buf = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, inFile->fd, 0)) != MAP_FAILED)
+    {
+#ifdef HAVE_MADVISE
+      madvise(inFile->buf, (size_t)sb.st_size, MADV_SEQUENTIAL);
+#endif
+      inFile->mapped = TRUE;
+      inFile->bufSize = inFile->bufLen = (size_t)sb.st_size;
+      return (inFile);
+    }
+    inFile->buf = NULL;
+
+    if (config->inputMethod EQ INPUT_MMAP && config->verbose)
+      fprintf(stderr, "Unable to map [%s] %d (%s), falling back to buffered reads\n", fName, errno, strerror(errno));
+#endif
+
+#ifdef HAVE_IO_URING
+    if (config->inputMethod EQ INPUT_URING && (inFile->uring = initUringReader(inFile->fd, sb.st_size)) != NULL)
+    {
+      if (config->verbose)
+        fprintf(stderr, "Reading [%s] with %d x %d KB io_uring reads in flight\n", fName, URING_DEPTH, URING_BLOCK_SIZE / 1024);
+    }
+    else
+#endif
+    {
+#ifdef HAVE_POSIX_FADVISE
+      posix_fadvise(inFile->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+      inFile->adviseOffset = 0;
+#endif
+      if (config->inputMethod EQ INPUT_URING && config->verbose)
+        fprintf(stderr, "io_uring is not available, reading [%s] with readahead\n", fName);
+    }
+  }
+  else
+    inFile->adviseOffset = -1;
+
+  /* stdin, pipes and anything that could not be mapped */
+  inFile->bufSize = INPUT_BLOCK_SIZE;
+  inFile->buf = (char *)XMALLOC(inFile->bufSize);
+
+  return (inFile);
+}
+
+#ifdef HAVE_IO_URING
+/****
+ *
+ * add bytes to the line carried from one io_uring block into the next
+ *
+ ****/
+
+PRIVATE int carryInput(struct inputFile_s *inFile, const char *data, size_t len)
+{
+  char *tmpPtr;
+  size_t newSize = inFile->bufSize;
+
+  while (newSize - inFile->bufLen < len)
+    newSize *= 2;
+  if (newSize != inFile->bufSize)
+  {
+    if ((tmpPtr = XREALLOC(inFile->buf, newSize)) EQ NULL)
+      return (FAILED);
+    inFile->buf = tmpPtr;
+    inFile->bufSize = newSize;
+  }
+
+  memcpy(inFile->buf + inFile->bufLen, data, len);
+  inFile->bufLen += len;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * next line of an io_uring input, scanned in the completed block
+ *
+ * the block is only given back for the next read once every line in it has
+ * been returned and the caller asks for another.
+ *
+ ****/
+
+PRIVATE int readUringLine(struct inputFile_s *inFile, char **line, size_t *lineLen)
+{
+  char *start, *nl;
+  size_t avail;
+  ssize_t rCount;
+
+  /* the carried line went out last time */
+  if (inFile->bufPos > 0)
+    inFile->bufLen = inFile->bufPos = 0;
+
+  for (;;)
+  {
+    if (inFile->blockPos < inFile->blockLen)
+    {
+      start = inFile->block + inFile->blockPos;
+      avail = inFile->blockLen - inFile->blockPos;
+
+      if ((nl = memchr(start, '\n', avail)) EQ NULL)
+      {
+        /* runs into the next block */
+        if (carryInput(inFile, start, avail) EQ FAILED)
+          return (FALSE);
+        inFile->blockPos = inFile->blockLen;
+        continue;
+      }
+
+      *lineLen = nl - start;
+      inFile->blockPos += *lineLen + 1;
+      if (inFile->bufLen > 0)
+      {
+        /* finish the carried line */
+        if (carryInput(inFile, start, *lineLen) EQ FAILED)
+          return (FALSE);
+        start = inFile->buf;
+        *lineLen = inFile->bufPos = inFile->bufLen;
+      }
+    }
+    else if (inFile->eof)
+    {
+      if (inFile->bufLen EQ 0)
+        return (FALSE);
+
+      /* last line is missing its <LF> */
+      start = inFile->buf;
+      *lineLen = inFile->bufPos = inFile->bufLen;
+    }
+    else
+    {
+      if ((rCount = uringNextBlock(inFile->uring, &inFile->block)) EQ FAILED)
+      {
+        fprintf(stderr, "ERR - Unable to read input %d (%s)\n", errno, strerror(errno));
+        inFile->eof = TRUE;
+      }
+      else if (rCount EQ 0)
+        inFile->eof = TRUE;
+      inFile->blockLen = (rCount > 0) ? (size_t)rCount : 0;
+      inFile->blockPos = 0;
+      continue;
+    }
+
+    if (*lineLen > 0 && start[*lineLen - 1] EQ '\r')
+      (*lineLen)--;
+    *line = start;
+    return (TRUE);
+  }
+}
+#endif
+
+/****
+ *
+ * return the next line without copying it, trailing <CR><LF> is not included
+ *
+ * the line is only good until the next call.
+ *
+ ****/
+
+int readInputLine(struct inputFile_s *inFile, char **line, size_t *lineLen)
+{
+  char *start, *nl, *tmpPtr;
+  size_t avail;
+  ssize_t rCount;
+
+#ifdef HAVE_IO_URING
+  if (inFile->uring != NULL)
+    return (readUringLine(inFile, line, lineLen));
+#endif
+
+  for (;;)
+  {
+    if (inFile->bufPos < inFile->bufLen)
+    {
+      start = inFile->buf + inFile->bufPos;
+      avail = inFile->bufLen - inFile->bufPos;
+
+      if ((nl = memchr(start, '\n', avail)) != NULL)
+      {
+        *lineLen = nl - start;
+        inFile->bufPos += *lineLen + 1;
+      }
+      else if (inFile->mapped || inFile->eof)
+      {
+        /* last line is missing its <LF> */
+        *lineLen = avail;
+        inFile->bufPos = inFile->bufLen;
+      }
+      else
+        start = NULL;
+
+      if (start != NULL)
+      {
+        if (*lineLen > 0 && start[*lineLen - 1] EQ '\r')
+          (*lineLen)--;
+        *line = start;
+        return (TRUE);
+      }
+    }
+    else if (inFile->mapped || inFile->eof)
+      return (FALSE);
+
+    /* move the partial line to the front of the buffer and refill */
+    if (inFile->bufPos > 0)
+    {
+      if (inFile->bufLen > inFile->bufPos)
+        memmove(inFile->buf, inFile->buf + inFile->bufPos, inFile->bufLen - inFile->bufPos);
+      inFile->bufLen -= inFile->bufPos;
+      inFile->bufPos = 0;
+    }
+
+    if (inFile->bufLen EQ inFile->bufSize)
+    {
+      /* line is longer than the buffer */
+      if ((tmpPtr = XREALLOC(inFile->buf, inFile->bufSize * 2)) EQ NULL)
+        return (FALSE);
+      inFile->buf = tmpPtr;
+      inFile->bufSize *= 2;
+    }
+
+    if ((rCount = readInputBlock(inFile, inFile->buf + inFile->bufLen, inFile->bufSize - inFile->bufLen)) EQ FAILED)
+    {
+      if (errno EQ EINTR)
+        continue;
+      fprintf(stderr, "ERR - Unable to read input %d (%s)\n", errno, strerror(errno));
+      inFile->eof = TRUE;
+    }
+    else if (rCount EQ 0)
+      inFile->eof = TRUE;
+    else
+      inFile->bufLen += rCount;
+  }
+}
+
+/****
+ *
+ * read the next block of a non-mapped input, io_uring inputs are scanned
+ * in their own blocks by readInputLine() instead
+ *
+ ****/
+
+ssize_t readInputBlock(struct inputFile_s *inFile, char *dst, size_t len)
+{
+  ssize_t rCount;
+
+#ifdef HAVE_POSIX_FADVISE
+  /* keep the kernel a window ahead of the reads */
+  if (inFile->adviseOffset >= 0 && inFile->readOffset + (off_t)len >= inFile->adviseOffset && inFile->adviseOffset < inFile->fileSize)
+  {
+    if (inFile->adviseOffset < inFile->readOffset)
+      inFile->adviseOffset = inFile->readOffset;
+    posix_fadvise(inFile->fd, inFile->adviseOffset, READAHEAD_SIZE, POSIX_FADV_WILLNEED);
+    inFile->adviseOffset += READAHEAD_SIZE;
+  }
+#endif
+
+  if ((rCount = read(inFile->fd, dst, len)) > 0)
+    inFile->readOffset += rCount;
+
+  return (rCount);
+}
+
+/****
+ *
+ * start of the first line at or after pos in a mapped file
+ *
+ ****/
+
+PRIVATE size_t lineBoundary(const struct inputFile_s *inFile, size_t pos)
+{
+  char *nl;
+
+  if (pos EQ 0 || pos >= inFile->bufLen)
+    return ((pos EQ 0) ? 0 : inFile->bufLen);
+
+  if ((nl = memchr(inFile->buf + pos - 1, '\n', inFile->bufLen - pos + 1)) EQ NULL)
+    return (inFile->bufLen);
+
+  return ((nl - inFile->buf) + 1);
+}
+
+/****
+ *
+ * view part of parts of a mapped file as its own input, split on lines
+ *
+ * the chunk shares the mapping and must not be closed.
+ *
+ ****/
+
+void splitInputChunk(const struct inputFile_s *inFile, int parts, int part, struct inputFile_s *chunk)
+{
+  size_t start = lineBoundary(inFile, (inFile->bufLen / parts) * part);
+  size_t end = (part EQ parts - 1) ? inFile->bufLen : lineBoundary(inFile, (inFile->bufLen / parts) * (part + 1));
+
+  viewInputBuffer(chunk, inFile->buf + start, end - start);
+}
+
+/****
+ *
+ * read the lines of a buffer through an input, the buffer is not copied
+ *
+ ****/
+
+void viewInputBuffer(struct inputFile_s *view, char *buf, size_t len)
+{
+  XMEMSET(view, 0, sizeof(struct inputFile_s));
+  view->fd = -1;
+  view->mapped = TRUE;
+  view->buf = buf;
+  view->bufSize = view->bufLen = len;
+  view->fileSize = (off_t)len;
+}
+
+/****
+ *
+ * close input file and release buffers
+ *
+ ****/
+
+void closeInputFile(struct inputFile_s *inFile)
+{
+  if (inFile EQ NULL)
+    return;
+
+#ifdef HAVE_MMAP
+  if (inFile->mapped)
+    munmap(inFile->buf, inFile->bufSize);
+  else
+#endif
+  if (inFile->buf != NULL)
+    XFREE(inFile->buf);
+
+#ifdef HAVE_IO_URING
+  freeUringReader(inFile->uring);
+#endif
+
+  if (inFile->fd != STDIN_FILENO)
+    close(inFile->fd);
+
+  XFREE(inFile);
+}
@@ -0,0 +1,119 @@
+/*****
+ *
+ * Description: Input Reader Headers
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+#ifndef INPUT_DOT_H
+#define INPUT_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+#include "mem.h"
+#include "util.h"
+#include "uring.h"
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+/* size of each read() when the input can not be mapped (stdin, pipes) */
+#define INPUT_BLOCK_SIZE (1024 * 1024)
+
+/* how regular files are read */
+#define INPUT_MMAP 0
+#define INPUT_READ 1
+#define INPUT_URING 2
+
+/* how far ahead of read() the kernel is asked to prefetch */
+#define READAHEAD_SIZE (8 * 1024 * 1024)
+
+/****
+ *
+ * typedefs & structs
+ *
+ ****/
+
+/*
+ * an input read line by line.  mapped files and views are scanned in buf,
+ * reads are buffered in buf.  io_uring blocks are scanned in place and buf
+ * only carries the line that runs from one block into the next.
+ */
+struct inputFile_s
+{
+  int fd;
+  int mapped;
+  int eof;
+  char *buf;
+  size_t bufSize;
+  size_t bufLen;
+  size_t bufPos;
+  off_t fileSize;
+  off_t readOffset;
+  off_t adviseOffset;
+  struct uringReader_s *uring;
+  char *block;
+  size_t blockLen;
+  size_t blockPos;
+};
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+struct inputFile_s *openInputFile(const char *fName);
+int readInputLine(struct inputFile_s *inFile, char **line, size_t *lineLen);
+ssize_t readInputBlock(struct inputFile_s *inFile, char *dst, size_t len);
+void splitInputChunk(const struct inputFile_s *inFile, int parts, int part, struct inputFile_s *chunk);
+void viewInputBuffer(struct inputFile_s *view, char *buf, size_t len);
+void closeInputFile(struct inputFile_s *inFile);
+
+#endif /* INPUT_DOT_H */
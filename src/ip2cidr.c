@@ -66,6 +66,9 @@ PRIVATE uint32_t hostSize[] = {
     8388608, 4194304, 2097152, 1048576, 524288, 262144, 131072, 65536, 32768, 16384, 8192, 4096, 2048,
     1024, 512, 256, 128, 64, 32, 16, 8, 4, 2, 1};
 
+PRIVATE uint64_t levelMinCount[33];
+PRIVATE int levelCountsReady = FALSE;
+
 /****
  *
  * global variables
@@ -81,9 +84,36 @@ PRIVATE uint32_t hostSize[] = {
 extern int errno;
 extern char **environ;
 extern Config_t *config;
+extern struct outputBuf_s *output;
 extern int quit;
 extern int reload;
 
+/****
+ *
+ * local prototypes
+ *
+ ****/
+
+PRIVATE int overThreshold(uint64_t count, uint32_t mask);
+PRIVATE size_t memLimitAddresses(void);
+PRIVATE int parseLine(struct addrSet_s *set, char *line, size_t lineLen, struct outputBuf_s *out, FILE *log);
+PRIVATE int parseParts(struct inputFile_s *inFile);
+PRIVATE int parseParallel(struct inputFile_s *inFile, struct addrSet_s *set, int parts);
+PRIVATE int parsePipeline(struct inputFile_s *inFile, struct addrSet_s *set);
+PRIVATE int pipeHost(struct pipeline_s *pipe, uint32_t addr);
+PRIVATE int initAddrSet(struct addrSet_s *set, off_t inputSize);
+PRIVATE int addSetHost(struct addrSet_s *set, uint32_t addr);
+PRIVATE int addSetCidr(struct addrSet_s *set, uint32_t network, int mask);
+PRIVATE int consolidateAddrSet(struct addrSet_s *set);
+PRIVATE void freeAddrSet(struct addrSet_s *set);
+PRIVATE int reserveAddress(struct addrVector_s *vec, struct extSort_s *ext);
+PRIVATE int spillAddrVector(struct addrVector_s *vec, struct extSort_s *ext);
+PRIVATE int consolidateExternal(struct extSort_s *ext, struct rangeVector_s *rangeVec);
+PRIVATE int streamHost(struct streamState_s *stream, uint32_t addr);
+PRIVATE int streamRange(struct streamState_s *stream, uint32_t start, uint32_t end);
+PRIVATE int finishStream(struct streamState_s *stream);
+PRIVATE void freeStream(struct streamState_s *stream);
+
 /****
  *
  * functions
@@ -98,335 +128,2196 @@ extern int reload;
 
 int processFile(const char *fName)
 {
-  FILE *inFile = NULL, *outFile = NULL;
-  char inBuf[8192];
-  char outFileName[PATH_MAX];
-  char patternBuf[4096];
-  char oBuf[4096];
-  // PRIVATE int c = 0, i, ret;
-  unsigned int lineCount = 0, lineLen = 0, minLineLen = sizeof(inBuf), maxLineLen = 0, totLineLen = 0;
-  unsigned int argCount = 0, totArgCount = 0;
-  struct in6_addr ip6_addr;
-  struct in_addr ip_addr;
-  uint32_t *ipv4List = NULL, ipv4Count = 0, *tmpPtr, startIp, hostIdCount;
+  struct inputFile_s *inFile;
+  char *line;
+  size_t lineLen;
+  struct addrSet_s addrSet;
   struct networkList_s netList;
-  int tmpOct1 = 0, tmpOct2 = 0, tmpOct3 = 0, tmpOct4 = 0, tmpMask = 0;
+  int parts = 0, ret;
 
   if (config->verbose)
     fprintf(stderr, "Opening [%s] for read\n", fName);
 
-  if (strcmp(fName, "-") EQ 0)
+  if ((inFile = openInputFile(fName)) EQ NULL)
+    return (EXIT_FAILURE);
+
+  /* large mapped files are parsed in chunks on several threads */
+  parts = parseParts(inFile);
+
+  /* parse workers size their own buffers */
+  if (initAddrSet(&addrSet, (parts > 1) ? 0 : inFile->fileSize) EQ FAILED)
   {
-    inFile = stdin;
+    fprintf(stderr, "Unable to allocate memory for IPv4 address buffer\n");
+    closeInputFile(inFile);
+    return (FAILED);
   }
-  else
+
+  if (parts > 1)
+    ret = parseParallel(inFile, &addrSet, parts);
+  else if ((ret = parsePipeline(inFile, &addrSet)) EQ FALSE)
   {
-#ifdef HAVE_FOPEN64
-    if ((inFile = fopen64(fName, "r")) EQ NULL)
-    {
-#else
-    if ((inFile = fopen(fName, "r")) EQ NULL)
-    {
-#endif
-      fprintf(stderr, "ERR - Unable to open file [%s] %d (%s)\n", fName, errno, strerror(errno));
-      return (EXIT_FAILURE);
-    }
+    ret = TRUE;
+    while (ret != FAILED && readInputLine(inFile, &line, &lineLen) && !quit)
+      ret = parseLine(&addrSet, line, lineLen, output, stderr);
   }
 
-  while (fgets(inBuf, sizeof(inBuf), inFile) != NULL && !quit)
+  if (ret EQ FAILED)
   {
-    /* strip trailing <CR><LF> */
-    inBuf[strcspn(inBuf, "\r\n")] = 0;
+    freeAddrSet(&addrSet);
+    closeInputFile(inFile);
+    return (FAILED);
+  }
 
-    /* test key is IPv4 */
-    if (inet_pton(AF_INET, inBuf, &ip_addr) EQ TRUE)
+  if (config->sortedInput)
+  {
+    if (finishStream(&addrSet.stream) EQ FAILED)
     {
-      /* process IPv4 address */
-
-      /* add to unsorted buffer */
-      ipv4Count++;
-      if ((tmpPtr = XREALLOC(ipv4List, ipv4Count * sizeof(uint32_t))) EQ NULL)
-      {
-        fprintf(stderr, "Unable to allocate memory for IPv4 address buffer\n");
-        if (ipv4List != NULL)
-          XFREE(ipv4List);
-        return (FAILED);
-      }
-      ipv4List = tmpPtr;
-      ipv4List[ipv4Count - 1] = ntohl(ip_addr.s_addr);
-#ifdef DEBUG
-      if (config->debug >= 9)
-        display(LOG_DEBUG, "%s [%u]", inBuf, ipv4List[ipv4Count - 1]);
-#endif
+      fprintf(stderr, "ERR - Problem consolidating to CIDR\n");
+      freeAddrSet(&addrSet);
+      closeInputFile(inFile);
+      return (FAILED);
     }
-    else if (inet_pton(AF_INET6, inBuf, &ip6_addr) EQ TRUE)
+
+    freeAddrSet(&addrSet);
+    closeInputFile(inFile);
+
+    return (EXIT_SUCCESS);
+  }
+
+  if (config->engine != ENGINE_LIST)
+  {
+    if (consolidateAddrSet(&addrSet) EQ FAILED)
     {
-      /* IPv6 address, not processed */
-      if (config->verbose)
-        fprintf(stderr, "IPv6 address [%s] sent to output without processing\n", inBuf);
-      printf("%s # IPv6 address\n", inBuf);
+      fprintf(stderr, "ERR - Problem consolidating to CIDR\n");
+      freeAddrSet(&addrSet);
+      closeInputFile(inFile);
+      return (FAILED);
     }
-    else if (sscanf(inBuf, "%d.%d.%d.%d/%d", &tmpOct1, &tmpOct2, &tmpOct3, &tmpOct4, &tmpMask) EQ 5)
-    {
-      /* this could be an IPv4 address with a netmask */
-      if ((tmpOct1 > 0 && tmpOct1 < 256) &&
-          (tmpOct2 > 0 && tmpOct2 < 256) &&
-          (tmpOct3 > 0 && tmpOct3 < 256) &&
-          (tmpOct4 > 0 && tmpOct4 < 256) &&
-          (tmpMask > 0 && tmpMask < 33))
-      {
-        if (tmpMask < config->minBits)
-        {
-          if (config->verbose)
-            fprintf(stderr, "IPv4 CIDR larger than minimum bitmask [%d.%d.%d.%d/%d] sent to output without processing\n", tmpOct1, tmpOct2, tmpOct3, tmpOct4, tmpMask);
-          printf("%s # CIDR too large to consolidate\n", inBuf);
-        }
-        else if (tmpMask EQ 32)
-        {
-          /* just one IP */
-          if (config->verbose)
-            fprintf(stderr, "Converting to host address [%d.%d.%d.%d/%d]\n", tmpOct1, tmpOct2, tmpOct3, tmpOct4, tmpMask);
-
-          sprintf(inBuf, "%d.%d.%d.%d", tmpOct1, tmpOct2, tmpOct3, tmpOct4);
-          inet_pton(AF_INET, inBuf, &ip_addr);
-
-          /* add to unsorted buffer */
-          ipv4Count++;
-          if ((tmpPtr = XREALLOC(ipv4List, ipv4Count * sizeof(uint32_t))) EQ NULL)
-          {
-            fprintf(stderr, "Unable to allocate memory for IPv4 address buffer\n");
-            if (ipv4List != NULL)
-              XFREE(ipv4List);
-            return (FAILED);
-          }
-          ipv4List = tmpPtr;
-          ipv4List[ipv4Count - 1] = ntohl(ip_addr.s_addr);
-        }
-        else
-        {
-          sprintf(inBuf, "%d.%d.%d.%d", tmpOct1, tmpOct2, tmpOct3, tmpOct4);
-          inet_pton(AF_INET, inBuf, &ip_addr);
-          startIp = ntohl(ip_addr.s_addr);
-          hostIdCount = hostSize[tmpMask];
-
-          /* confirm that the CIDR is valid (e.g., the node address is 0) */
-          if ((startIp & hostMasks[32 - tmpMask]) > 0)
-          {
-#ifdef DEBUG
-            if (config->debug >= 3)
-              fprintf(stderr, "DEBUG - Invalid CIDR [%08x][%08x][%08x]\n", startIp, netMasks[tmpMask], startIp & hostMasks[32 - tmpMask]);
-#endif
 
-            if (config->verbose)
-              fprintf(stderr, "CIDR is not valid, host id is not zero [%d.%d.%d.%d/%d] sent to output without processing\n", tmpOct1, tmpOct2, tmpOct3, tmpOct4, tmpMask);
-            printf("%s/%d # CIDR invalid\n", inBuf, tmpMask);
-          }
-          else
-          {
-            if (config->verbose)
-              fprintf(stderr, "Processing IPv4 CIDR [%d.%d.%d.%d/%d]\n", tmpOct1, tmpOct2, tmpOct3, tmpOct4, tmpMask);
-
-            /* grow IP buffer for CIDR */
-            if ((tmpPtr = XREALLOC(ipv4List, (ipv4Count + hostIdCount) * sizeof(uint32_t))) EQ NULL)
-            {
-              fprintf(stderr, "Unable to allocate memory for IPv4 address buffer\n");
-              if (ipv4List != NULL)
-                XFREE(ipv4List);
-              return (FAILED);
-            }
-            ipv4List = tmpPtr;
-
-            for (uint32_t i = 0; i < hostIdCount; ++i)
-              ipv4List[ipv4Count++] = startIp + i;
-          }
-        }
-      }
-    }
-    else
+    freeAddrSet(&addrSet);
+    closeInputFile(inFile);
+
+    return (EXIT_SUCCESS);
+  }
+
+  if (addrSet.extSort.runCount > 0)
+  {
+    /* list did not fit in memory, merge the spilled runs */
+    if (addrSet.addrVec.count > 0 && spillAddrVector(&addrSet.addrVec, &addrSet.extSort) EQ FAILED)
+      ret = FAILED;
+
+    /* the merge buffers take the place of the address buffer */
+    freeAddrVector(&addrSet.addrVec);
+
+    if (ret EQ FAILED || consolidateExternal(&addrSet.extSort, &addrSet.rangeVec) EQ FAILED)
     {
-      /* pass line alone without processing, probably a network range or IPv6 address */
-      if (config->verbose)
-        fprintf(stderr, "Non-IP address [%s] sent to output without processing\n", inBuf);
-      printf("%s # unknown format\n", inBuf);
+      fprintf(stderr, "ERR - Problem consolidating spilled runs\n");
+      freeAddrSet(&addrSet);
+      closeInputFile(inFile);
+      return (FAILED);
     }
+
+    freeAddrSet(&addrSet);
+    closeInputFile(inFile);
+
+    return (EXIT_SUCCESS);
   }
 
+  /* release the unused tail of the address buffer */
+  shrinkAddrVector(&addrSet.addrVec);
+
+  if (config->verbose)
+    fprintf(stderr, "Read [%lu] IPv4 addresses and [%lu] IPv4 CIDRs\n", (unsigned long)addrSet.addrVec.count, (unsigned long)addrSet.rangeVec.count);
+
   /* sort ipv4 list */
   if (config->verbose)
     fprintf(stderr, "Sorting IPv4 List\n");
-  quickSort32(ipv4List, 0, ipv4Count - 1);
+  sortIPv4ListCounted(addrSet.addrVec.list, addrSet.addrVec.count, addrSet.radixHist);
+  sortRanges(addrSet.rangeVec.list, addrSet.rangeVec.count);
 
-  netList.ipv4List = ipv4List;
-  netList.ipv4Count = ipv4Count;
+  netList.ipv4List = addrSet.addrVec.list;
+  netList.ipv4Count = addrSet.addrVec.count;
+  netList.rangeList = addrSet.rangeVec.list;
+  netList.rangeCount = addrSet.rangeVec.count;
+  netList.maskOut = NULL;
+  netList.packed = NULL;
+  XMEMSET(&netList.cidrs, 0, sizeof(netList.cidrs));
 
   /* remove duplicates */
+  if (config->verbose)
+    fprintf(stderr, "Removing duplicates\n");
+
   if (uniqueIPv4List(&netList) EQ EXIT_FAILURE)
   {
     fprintf(stderr, "ERR - Unable to remove duplicate IP addresses\n");
-    if (netList.ipv4List != NULL)
-      XFREE(netList.ipv4List);
+    freeIPv4List(&netList);
+    closeInputFile(inFile);
+    return (FAILED);
+  }
+
+  if (config->compress && packIPv4List(&netList) EQ EXIT_FAILURE)
+  {
+    fprintf(stderr, "ERR - Unable to pack IP address list\n");
+    freeIPv4List(&netList);
+    closeInputFile(inFile);
     return (FAILED);
   }
 
+  if (config->exact)
+  {
+    if (config->verbose)
+      fprintf(stderr, "Aggregating [%llu] addresses to the minimal CIDR cover\n", (unsigned long long)countIPv4List(&netList));
+
+    if (aggregateIPv4List(&netList) EQ EXIT_FAILURE)
+    {
+      fprintf(stderr, "ERR - Problem aggregating to CIDR\n");
+      freeIPv4List(&netList);
+      closeInputFile(inFile);
+      return (FAILED);
+    }
+
+    freeIPv4List(&netList);
+    closeInputFile(inFile);
+
+    return (EXIT_SUCCESS);
+  }
+
   /* bitmask summarization */
   if (config->verbose)
     fprintf(stderr, "Consolidating IPs to CIDRs\n");
 
   if (config->verbose)
-    fprintf(stderr, "Starting IP list size [%d]\n", netList.ipv4Count);
+    fprintf(stderr, "Starting IP list size [%llu]\n", (unsigned long long)countIPv4List(&netList));
 
-  for (int mask = config->minBits; mask <= config->maxBits; ++mask)
+  if (config->verbose)
+    fprintf(stderr, "Consolidating /%d through /%d\n", config->minBits, config->maxBits);
+
+  if (consolidateIPv4List(&netList) EQ EXIT_FAILURE)
   {
-    if (consolidateIPv4List(&netList, mask) EQ EXIT_FAILURE)
-    {
-      fprintf(stderr, "ERR - Problem consolidating to CIDR\n");
-      if (netList.ipv4List != NULL)
-        XFREE(netList.ipv4List);
-      return (FAILED);
-    }
+    fprintf(stderr, "ERR - Problem consolidating to CIDR\n");
+    freeIPv4List(&netList);
+    closeInputFile(inFile);
+    return (FAILED);
   }
 
   if (config->verbose)
     fprintf(stderr, "Sending remaining IP addresses to output\n");
 
   /* print what is left after consolidation */
-  for (uint32_t i = 0; i < netList.ipv4Count; ++i)
-  {
-    ip_addr.s_addr = htonl(netList.ipv4List[i]);
-    printf("%s/32\n", inet_ntoa(ip_addr));
-  }
+  printIPv4List(&netList, output);
 
   if (config->verbose)
-    fprintf(stderr, "Ending IP list size [%d]\n", netList.ipv4Count);
+    fprintf(stderr, "Ending IP list size [%llu]\n", (unsigned long long)countIPv4List(&netList));
 
   /* cleanup memory */
-  if (netList.ipv4List != NULL)
-    XFREE(netList.ipv4List);
+  freeIPv4List(&netList);
 
   if (config->verbose)
     fprintf(stderr, "Closing [%s]\n", fName);
 
-  if (inFile != stdin)
-    fclose(inFile);
+  closeInputFile(inFile);
 
   return (EXIT_SUCCESS);
 }
 
 /****
  *
- * consolidate ipv4 list to cidr blocks
+ * parse one input line into the address set
+ *
+ * lines that are not consolidated go to out and verbose messages to log so
+ * parse workers can keep them in file order.
  *
  ****/
 
-int consolidateIPv4List(struct networkList_s *netList, uint32_t mask)
+PRIVATE int parseLine(struct addrSet_s *set, char *line, size_t lineLen, struct outputBuf_s *out, FILE *log)
 {
-  PRIVATE uint32_t curNet = 0, curCount = 0, curStart = 0, curEnd = 0, network;
-  uint32_t *list = netList->ipv4List;
-  uint32_t *newList, newListCount = 0;
-  struct in_addr ip_addr, mask_addr;
-  char ipAddr[INET_ADDRSTRLEN], netAddr[INET_ADDRSTRLEN];
-
-  if ((newList = XMALLOC(netList->ipv4Count * sizeof(uint32_t))) EQ NULL)
-  {
-    fprintf(stderr, "ERR - Unable to allocate memory for new list\n");
-    return (EXIT_FAILURE);
-  }
+  char inBuf[INET6_ADDRSTRLEN];
+  struct in6_addr ip6_addr;
+  uint32_t startIp;
+  int addrType, tmpMask = 0;
 
-  if (config->verbose)
-    fprintf(stderr, "Consolidating /%d\n", mask);
+  addrType = parseAddress(line, lineLen, &startIp, &tmpMask);
 
-  for (uint32_t i = 0; i < netList->ipv4Count; ++i)
+  if (addrType EQ ADDR_TYPE_IPV4)
   {
-    network = netList->ipv4List[i] & netMasks[mask];
+    /* process IPv4 address */
 
-    if (i EQ 0)
-      curNet = network;
-    else if (network != curNet)
+    /* add to unsorted buffer */
+    if (addSetHost(set, startIp) EQ FAILED)
+    {
+      fprintf(log, "ERR - Unable to add IPv4 address [%.*s]\n", (int)lineLen, line);
+      return (FAILED);
+    }
+#ifdef DEBUG
+    if (config->debug >= 9)
+      display(LOG_DEBUG, "%.*s [%u]", (int)lineLen, line, startIp);
+#endif
+  }
+  else if (addrType EQ ADDR_TYPE_IPV4_CIDR)
+  {
+    /* IPv4 address with a netmask */
+    if (tmpMask < config->minBits && !config->exact)
+    {
+      if (config->verbose)
+        fprintf(log, "IPv4 CIDR larger than minimum bitmask [%.*s] sent to output without processing\n", (int)lineLen, line);
+      if (config->outputFormat != FORMAT_PLAIN && (startIp & hostMasks[32 - tmpMask]) EQ 0)
+        /* loaders take the CIDR as it is */
+        writeOutputCidr(out, startIp, tmpMask);
+      else
+        passOutput(out, line, lineLen, "CIDR too large to consolidate");
+    }
+    else if (tmpMask EQ 32)
     {
-      /* network has changed, process the count */
-      curEnd = i - 1;
+      /* just one IP */
+      if (config->verbose)
+        fprintf(log, "Converting to host address [%.*s]\n", (int)lineLen, line);
 
-      if (((float)curCount / (float)hostSize[mask]) > config->threshold)
+      /* add to unsorted buffer */
+      if (addSetHost(set, startIp) EQ FAILED)
+      {
+        fprintf(log, "ERR - Unable to add IPv4 address [%.*s]\n", (int)lineLen, line);
+        return (FAILED);
+      }
+    }
+    else
+    {
+      /* confirm that the CIDR is valid (e.g., the node address is 0) */
+      if ((startIp & hostMasks[32 - tmpMask]) > 0)
       {
-        mask_addr.s_addr = htonl(curNet);
-        sprintf(netAddr, "%s", inet_ntoa(mask_addr));
 #ifdef DEBUG
-        if (config->debug >= 4)
-          fprintf( stderr, "DEBUG - Consolidating to %s/%d (%d)\n", netAddr, mask, curCount);
+        if (config->debug >= 3)
+          fprintf(log, "DEBUG - Invalid CIDR [%08x][%08x][%08x]\n", startIp, netMasks[tmpMask], startIp & hostMasks[32 - tmpMask]);
 #endif
 
-        printf("%s/%d\n", netAddr, mask);
+        if (config->verbose)
+          fprintf(log, "CIDR is not valid, host id is not zero [%.*s] sent to output without processing\n", (int)lineLen, line);
+        passOutput(out, line, lineLen, "CIDR invalid");
       }
       else
       {
-        for (uint32_t x = curStart; x < i; ++x)
-          newList[newListCount++] = list[x];
+        if (config->verbose)
+          fprintf(log, "Processing IPv4 CIDR [%.*s]\n", (int)lineLen, line);
+
+        /* keep the CIDR as a range instead of expanding every host */
+        if (addSetCidr(set, startIp, tmpMask) EQ FAILED)
+        {
+          fprintf(log, "ERR - Unable to add IPv4 CIDR [%.*s]\n", (int)lineLen, line);
+          return (FAILED);
+        }
       }
+    }
+  }
+  else
+  {
+    if (addrType EQ ADDR_TYPE_IPV6 && lineLen < sizeof(inBuf))
+    {
+      /* inet_pton() needs a terminated string */
+      memcpy(inBuf, line, lineLen);
+      inBuf[lineLen] = 0;
 
-      /* starting a new network block */
-      curNet = network;
-      curCount = 0;
-      curStart = i;
+      if (inet_pton(AF_INET6, inBuf, &ip6_addr) EQ TRUE)
+      {
+        /* IPv6 address, not processed */
+        if (config->verbose)
+          fprintf(log, "IPv6 address [%s] sent to output without processing\n", inBuf);
+        passOutput(out, line, lineLen, "IPv6 address");
+        return (TRUE);
+      }
     }
-    curCount++;
+
+    /* pass line alone without processing, probably a network range */
+    if (config->verbose)
+      fprintf(log, "Non-IP address [%.*s] sent to output without processing\n", (int)lineLen, line);
+    passOutput(out, line, lineLen, "unknown format");
   }
 
-  /* switch to new shorter list */
-  netList->ipv4List = newList;
-  netList->ipv4Count = newListCount;
+  return (TRUE);
+}
 
-  /* cleanup old list */
-  if (list != NULL)
-    XFREE(list);
+/****
+ *
+ * number of chunks to parse a file in, 1 to parse it on this thread
+ *
+ * only the list engine collects into vectors that can be joined and the
+ * spill and sorted input paths need the addresses in file order.
+ *
+ ****/
 
-  return (EXIT_SUCCESS);
+PRIVATE int parseParts(struct inputFile_s *inFile)
+{
+#ifdef HAVE_PARALLEL_PARSE
+  off_t parts;
+
+  if (!inFile->mapped || config->threads < 2 || config->engine != ENGINE_LIST || config->sortedInput || config->memLimit > 0)
+    return (1);
+
+  parts = inFile->fileSize / PARSE_CHUNK_MIN;
+  if (parts > config->threads)
+    parts = config->threads;
+
+  return ((parts > 1) ? (int)parts : 1);
+#else
+  return (1);
+#endif
 }
 
+#ifdef HAVE_PARALLEL_PARSE
 /****
  *
- * consolidate ipv4 list to cidr blocks
+ * parse worker, parse one chunk into its own set and output buffers
  *
  ****/
 
-int uniqueIPv4List(struct networkList_s *netList)
+PRIVATE void *parseWorker(void *arg)
 {
-  PRIVATE uint32_t curNet = 0, curCount = 0, curStart = 0, curEnd = 0, network;
-  uint32_t *list = netList->ipv4List;
-  uint32_t *newList, *tmpPtr, newListCount = 0;
+  struct parseWorker_s *worker = arg;
+  char *line;
+  size_t lineLen;
+  FILE *log;
 
-  if ((newList = XMALLOC(netList->ipv4Count * sizeof(uint32_t))) EQ NULL)
+  if ((worker->out = openOutput(-1)) EQ NULL)
   {
-    fprintf(stderr, "ERR - Unable to allocate memory for new list\n");
-    return (EXIT_FAILURE);
+    worker->ret = FAILED;
+    return (NULL);
+  }
+  if ((log = open_memstream(&worker->logBuf, &worker->logLen)) EQ NULL)
+  {
+    worker->ret = FAILED;
+    return (NULL);
+  }
+
+  while (worker->ret != FAILED && readInputLine(&worker->chunk, &line, &lineLen) && !quit)
+    worker->ret = parseLine(&worker->set, line, lineLen, worker->out, log);
+  endOutputChunk(worker->out);
+
+  fclose(log);
+
+  return (NULL);
+}
+#endif
+
+/****
+ *
+ * parse newline aligned chunks of a mapped file on parallel threads
+ *
+ * every worker fills its own vectors and buffers its passthrough lines and
+ * messages.  the buffers are written in chunk order so output keeps the
+ * order of the file, and the vectors are joined for the sort.
+ *
+ ****/
+
+PRIVATE int parseParallel(struct inputFile_s *inFile, struct addrSet_s *set, int parts)
+{
+#ifdef HAVE_PARALLEL_PARSE
+  struct parseWorker_s *workers;
+  pthread_t *tids;
+  size_t total = 0;
+  int started, ret = TRUE;
+
+  workers = (struct parseWorker_s *)XMALLOC(parts * sizeof(struct parseWorker_s));
+  tids = (pthread_t *)XMALLOC(parts * sizeof(pthread_t));
+
+  for (int i = 0; i < parts; ++i)
+  {
+    splitInputChunk(inFile, parts, i, &workers[i].chunk);
+    if (initAddrSet(&workers[i].set, workers[i].chunk.fileSize) EQ FAILED)
+      workers[i].ret = FAILED;
   }
 
   if (config->verbose)
-    fprintf(stderr, "Removing duplicates\n");
+    fprintf(stderr, "Parsing input in [%d] chunks\n", parts);
 
-  /* copy the first IP */
-  if (netList->ipv4Count > 0)
-    newList[newListCount++] = list[0];
+  for (started = 0; started < parts; ++started)
+    if (pthread_create(&tids[started], NULL, parseWorker, &workers[started]) != 0)
+    {
+      /* finish the remaining chunks on this thread */
+      for (int i = started; i < parts; ++i)
+        parseWorker(&workers[i]);
+      break;
+    }
 
-  for (uint32_t i = 1; i < netList->ipv4Count; ++i)
-    if (list[i] != newList[newListCount - 1])
-      newList[newListCount++] = list[i];
+  for (int i = 0; i < started; ++i)
+    pthread_join(tids[i], NULL);
 
-  if (newListCount < netList->ipv4Count)
+  for (int i = 0; i < parts; ++i)
   {
-    /* resize the IP list */
-    if ((tmpPtr = XREALLOC(newList, newListCount * sizeof(uint32_t))) EQ NULL)
-      fprintf(stderr, "ERR - Unable to allocate memory for new list\n");
-    else
-      newList = tmpPtr;
+    if (workers[i].out != NULL && workers[i].out->len > 0)
+      writeOutput(output, workers[i].out->buf, workers[i].out->len);
+    if (workers[i].logLen > 0)
+      fwrite(workers[i].logBuf, 1, workers[i].logLen, stderr);
+    if (workers[i].ret EQ FAILED)
+      ret = FAILED;
+    total += workers[i].set.addrVec.count;
   }
 
-  /* switch to new shorter list */
-  netList->ipv4List = newList;
-  netList->ipv4Count = newListCount;
+  /* join the vectors in chunk order */
+  if (ret != FAILED && total > set->addrVec.size && growAddrVector(&set->addrVec, total) EQ FAILED)
+    ret = FAILED;
 
-  /* cleanup old list */
-  if (list != NULL)
-    XFREE(list);
+  for (int i = 0; i < parts; ++i)
+  {
+    if (ret != FAILED && workers[i].set.addrVec.count > 0)
+    {
+      XMEMCPY(set->addrVec.list + set->addrVec.count, workers[i].set.addrVec.list, workers[i].set.addrVec.count * sizeof(uint32_t));
+      set->addrVec.count += workers[i].set.addrVec.count;
+    }
+    for (size_t r = 0; ret != FAILED && r < workers[i].set.rangeVec.count; ++r)
+      ret = addRangeVector(&set->rangeVec, workers[i].set.rangeVec.list[r].start, workers[i].set.rangeVec.list[r].end);
 
-  return (EXIT_SUCCESS);
+    freeAddrSet(&workers[i].set);
+    closeOutput(workers[i].out);
+    if (workers[i].logBuf != NULL)
+      free(workers[i].logBuf);
+  }
+
+  XFREE(tids);
+  XFREE(workers);
+
+  return (ret);
+#else
+  return (FAILED);
+#endif
+}
+
+#ifdef HAVE_PIPELINE
+/****
+ *
+ * pipeline reader, fill buffers that end on a line break
+ *
+ ****/
+
+PRIVATE void *pipeReader(void *arg)
+{
+  struct pipeline_s *pipe = arg;
+  struct pipeBuffer_s *buf;
+  char *tmpPtr;
+  size_t lastNl;
+  ssize_t rCount;
+  int eof = FALSE;
+
+  while (!eof && !quit)
+  {
+    ringPop(&pipe->freeBuffers, (void **)&buf);
+
+    /* start with the partial line left over from the last buffer */
+    buf->len = 0;
+    if (pipe->carryLen > buf->size)
+    {
+      if ((tmpPtr = XREALLOC(buf->data, pipe->carryLen * 2)) EQ NULL)
+        break;
+      buf->data = tmpPtr;
+      buf->size = pipe->carryLen * 2;
+    }
+    if (pipe->carryLen > 0)
+      XMEMCPY(buf->data, pipe->carry, pipe->carryLen);
+    buf->len = pipe->carryLen;
+    pipe->carryLen = 0;
+
+    for (;;)
+    {
+      while (buf->len < buf->size && !eof)
+      {
+        if ((rCount = readInputBlock(pipe->inFile, buf->data + buf->len, buf->size - buf->len)) EQ FAILED)
+        {
+          if (errno EQ EINTR)
+            continue;
+          fprintf(stderr, "ERR - Unable to read input %d (%s)\n", errno, strerror(errno));
+          eof = TRUE;
+        }
+        else if (rCount EQ 0)
+          eof = TRUE;
+        else
+          buf->len += rCount;
+      }
+
+      for (lastNl = buf->len; lastNl > 0 && buf->data[lastNl - 1] != '\n'; --lastNl)
+        ;
+      if (eof || lastNl > 0)
+        break;
+
+      /* line is longer than the buffer */
+      if ((tmpPtr = XREALLOC(buf->data, buf->size * 2)) EQ NULL)
+      {
+        eof = TRUE;
+        break;
+      }
+      buf->data = tmpPtr;
+      buf->size *= 2;
+    }
+
+    if (!eof && lastNl < buf->len)
+    {
+      /* hold the partial last line for the next buffer */
+      pipe->carryLen = buf->len - lastNl;
+      if (pipe->carryLen > pipe->carrySize)
+      {
+        if ((tmpPtr = XREALLOC(pipe->carry, pipe->carryLen)) EQ NULL)
+          break;
+        pipe->carry = tmpPtr;
+        pipe->carrySize = pipe->carryLen;
+      }
+      XMEMCPY(pipe->carry, buf->data + lastNl, pipe->carryLen);
+      buf->len = lastNl;
+    }
+
+    ringPush(&pipe->fullBuffers, buf);
+  }
+
+  ringClose(&pipe->fullBuffers);
+
+  return (NULL);
+}
+
+/****
+ *
+ * pipeline sorter, append batches to the list and count their radix digits
+ *
+ ****/
+
+PRIVATE void *pipeSorter(void *arg)
+{
+  struct pipeline_s *pipe = arg;
+  struct addrVector_s *vec = &pipe->set->addrVec;
+  struct addrBatch_s *batch;
+
+  while (ringPop(&pipe->fullBatches, (void **)&batch))
+  {
+    if (!pipe->sortFailed)
+    {
+      if (vec->count + batch->count > vec->size && growAddrVector(vec, vec->count + batch->count) EQ FAILED)
+        pipe->sortFailed = TRUE;
+      else
+      {
+        XMEMCPY(vec->list + vec->count, batch->list, batch->count * sizeof(uint32_t));
+        radixHistogram32(batch->list, batch->count, pipe->set->radixHist);
+        vec->count += batch->count;
+      }
+    }
+
+    batch->count = 0;
+    ringPush(&pipe->freeBatches, batch);
+  }
+
+  return (NULL);
+}
+#endif
+
+/****
+ *
+ * hand a parsed host to the sorter thread
+ *
+ ****/
+
+PRIVATE int pipeHost(struct pipeline_s *pipe, uint32_t addr)
+{
+#ifdef HAVE_PIPELINE
+  if (pipe->batch->count EQ PIPE_BATCH_SIZE)
+  {
+    ringPush(&pipe->fullBatches, pipe->batch);
+    ringPop(&pipe->freeBatches, (void **)&pipe->batch);
+  }
+  pipe->batch->list[pipe->batch->count++] = addr;
+
+  return (TRUE);
+#else
+  return (FAILED);
+#endif
+}
+
+/****
+ *
+ * free the pipeline buffers
+ *
+ ****/
+
+PRIVATE void freePipeline(struct pipeline_s *pipe)
+{
+  for (int i = 0; i < PIPE_BUFFERS; ++i)
+    if (pipe->buffers[i].data != NULL)
+      XFREE(pipe->buffers[i].data);
+  if (pipe->batches != NULL)
+    XFREE(pipe->batches);
+  if (pipe->carry != NULL)
+    XFREE(pipe->carry);
+  freeRing(&pipe->fullBuffers);
+  freeRing(&pipe->freeBuffers);
+  freeRing(&pipe->fullBatches);
+  freeRing(&pipe->freeBatches);
+  XFREE(pipe);
+}
+
+/****
+ *
+ * parse a pipe or stdin with reading, parsing and collecting overlapped
+ *
+ * a reader thread fills line aligned buffers, this thread parses them and
+ * a sorter thread appends the address batches to the list while building
+ * the radix histograms.  passthrough lines are written by this thread so
+ * they keep their order.  returns FALSE when the input is not a candidate
+ * or the threads could not be started, nothing has been read then.
+ *
+ ****/
+
+PRIVATE int parsePipeline(struct inputFile_s *inFile, struct addrSet_s *set)
+{
+#ifdef HAVE_PIPELINE
+  struct pipeline_s *pipe;
+  struct pipeBuffer_s *buf;
+  struct inputFile_s view;
+  pthread_t readerTid, sorterTid;
+  char *line;
+  size_t lineLen;
+  int ret = TRUE;
+
+  /* io_uring already overlaps the reads and its blocks are scanned in place */
+  if (inFile->mapped || inFile->eof || inFile->uring != NULL || config->threads < 2 || config->engine != ENGINE_LIST || config->sortedInput ||
+      config->memLimit > 0)
+    return (FALSE);
+
+  pipe = (struct pipeline_s *)XMALLOC(sizeof(struct pipeline_s));
+  pipe->inFile = inFile;
+  pipe->set = set;
+  if (initRing(&pipe->fullBuffers, PIPE_BUFFERS) EQ FAILED || initRing(&pipe->freeBuffers, PIPE_BUFFERS) EQ FAILED ||
+      initRing(&pipe->fullBatches, PIPE_BATCHES) EQ FAILED || initRing(&pipe->freeBatches, PIPE_BATCHES) EQ FAILED ||
+      (pipe->batches = (struct addrBatch_s *)XMALLOC(PIPE_BATCHES * sizeof(struct addrBatch_s))) EQ NULL)
+  {
+    freePipeline(pipe);
+    return (FALSE);
+  }
+
+  for (int i = 0; i < PIPE_BUFFERS; ++i)
+  {
+    pipe->buffers[i].size = INPUT_BLOCK_SIZE;
+    if ((pipe->buffers[i].data = (char *)XMALLOC(INPUT_BLOCK_SIZE)) EQ NULL)
+    {
+      freePipeline(pipe);
+      return (FALSE);
+    }
+    ringPush(&pipe->freeBuffers, &pipe->buffers[i]);
+  }
+  pipe->batch = &pipe->batches[0];
+  for (int i = 1; i < PIPE_BATCHES; ++i)
+    ringPush(&pipe->freeBatches, &pipe->batches[i]);
+
+  set->radixHist = (size_t *)XMALLOC(RADIX_PASSES * RADIX_BUCKETS * sizeof(size_t));
+
+  if (pthread_create(&sorterTid, NULL, pipeSorter, pipe) != 0)
+  {
+    freePipeline(pipe);
+    XFREE(set->radixHist);
+    set->radixHist = NULL;
+    return (FALSE);
+  }
+  if (pthread_create(&readerTid, NULL, pipeReader, pipe) != 0)
+  {
+    ringClose(&pipe->fullBatches);
+    pthread_join(sorterTid, NULL);
+    freePipeline(pipe);
+    XFREE(set->radixHist);
+    set->radixHist = NULL;
+    return (FALSE);
+  }
+  set->pipe = pipe;
+
+  if (config->verbose)
+    fprintf(stderr, "Reading, parsing and collecting on separate threads\n");
+
+  /* keep draining after a failure so the reader can finish */
+  while (ringPop(&pipe->fullBuffers, (void **)&buf))
+  {
+    viewInputBuffer(&view, buf->data, buf->len);
+    while (ret != FAILED && readInputLine(&view, &line, &lineLen))
+      ret = parseLine(set, line, lineLen, output, stderr);
+    ringPush(&pipe->freeBuffers, buf);
+  }
+
+  if (pipe->batch->count > 0)
+    ringPush(&pipe->fullBatches, pipe->batch);
+  ringClose(&pipe->fullBatches);
+
+  pthread_join(readerTid, NULL);
+  pthread_join(sorterTid, NULL);
+
+  if (pipe->sortFailed)
+    ret = FAILED;
+
+  set->pipe = NULL;
+  freePipeline(pipe);
+  inFile->eof = TRUE;
+
+  return (ret);
+#else
+  return (FALSE);
+#endif
+}
+
+/****
+ *
+ * true when count addresses fill enough of a /mask block to consolidate
+ *
+ ****/
+
+PRIVATE int overThreshold(uint64_t count, uint32_t mask)
+{
+  return (((float)count / (float)hostSize[mask]) > config->threshold);
+}
+
+/****
+ *
+ * print a consolidated cidr block
+ *
+ ****/
+
+PRIVATE void printCidr(struct outputBuf_s *out, uint32_t network, uint32_t mask)
+{
+#ifdef DEBUG
+  struct in_addr mask_addr;
+
+  mask_addr.s_addr = htonl(network);
+  if (config->debug >= 4)
+    fprintf(stderr, "DEBUG - Consolidating to %s/%d\n", inet_ntoa(mask_addr), mask);
+#endif
+
+  writeOutputCidr(out, network, (int)mask);
+}
+
+/****
+ *
+ * merge sorted overlapping and adjacent ranges in place, returns new count
+ *
+ ****/
+
+PRIVATE uint32_t mergeRanges(struct ipv4Range_s *ranges, uint32_t rangeCount)
+{
+  uint32_t newRangeCount = 0;
+
+  for (uint32_t i = 0; i < rangeCount; ++i)
+  {
+    if (newRangeCount > 0 && (uint64_t)ranges[i].start <= (uint64_t)ranges[newRangeCount - 1].end + 1)
+    {
+      if (ranges[i].end > ranges[newRangeCount - 1].end)
+        ranges[newRangeCount - 1].end = ranges[i].end;
+    }
+    else
+      ranges[newRangeCount++] = ranges[i];
+  }
+
+  return (newRangeCount);
+}
+
+/****
+ *
+ * smallest address count that consolidates a block at each mask
+ *
+ * overThreshold() is monotonic in count so a binary search over the block
+ * size finds the exact cut-over, including float rounding.  blocks that can
+ * never pass get one more than their size.
+ *
+ ****/
+
+PRIVATE void initLevelCounts(void)
+{
+  uint64_t lo, hi, mid;
+
+  if (levelCountsReady)
+    return;
+
+  for (int mask = 0; mask <= 32; ++mask)
+  {
+    lo = 0;
+    hi = ((uint64_t)1 << (32 - mask)) + 1;
+    while (lo < hi)
+    {
+      mid = lo + (hi - lo) / 2;
+      if (overThreshold(mid, mask))
+        hi = mid;
+      else
+        lo = mid + 1;
+    }
+    levelMinCount[mask] = lo;
+  }
+
+  levelCountsReady = TRUE;
+}
+
+/****
+ *
+ * close the deepest open block
+ *
+ * a block that passes the threshold replaces every candidate and leftover
+ * added since it was opened, its count always rolls up into the parent.
+ *
+ ****/
+
+PRIVATE int closeLevel(struct consolidateState_s *state)
+{
+  struct consolidateLevel_s *level = &state->level[state->depth];
+
+  if (level->count >= levelMinCount[state->depth])
+  {
+    state->cidrs.count = level->cidrMark;
+    state->hostCount = level->hostMark;
+    state->ranges.count = level->rangeMark;
+    if (addCidrVector(&state->cidrs, level->network, state->depth) EQ FAILED)
+      return (FAILED);
+  }
+
+  if (state->depth > config->minBits)
+    state->level[state->depth - 1].count += level->count;
+  state->depth--;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * close the open blocks that do not hold addr and open blocks down to mask
+ *
+ ****/
+
+PRIVATE int enterLevels(struct consolidateState_s *state, uint32_t addr, int mask)
+{
+  struct consolidateLevel_s *level;
+
+  while (state->depth >= config->minBits && (addr & netMasks[state->depth]) != state->level[state->depth].network)
+    if (closeLevel(state) EQ FAILED)
+      return (FAILED);
+
+  while (state->depth < mask)
+  {
+    level = &state->level[++state->depth];
+    level->network = addr & netMasks[state->depth];
+    level->count = 0;
+    level->cidrMark = state->cidrs.count;
+    level->hostMark = state->hostCount;
+    level->rangeMark = state->ranges.count;
+  }
+
+  return (TRUE);
+}
+
+/****
+ *
+ * group the networks of the kept blocks by mask
+ *
+ * the counting sort keeps address order inside each mask, mask m ends at
+ * offsets[m] and starts where mask m - 1 ends.
+ *
+ ****/
+
+PRIVATE uint32_t *groupCidrs(struct cidrVector_s *cidrs, size_t *offsets)
+{
+  uint32_t *networks;
+
+  if ((networks = XMALLOC(cidrs->count * sizeof(uint32_t))) EQ NULL)
+    return (NULL);
+
+  XMEMSET(offsets, 0, 34 * sizeof(size_t));
+  for (size_t i = 0; i < cidrs->count; ++i)
+    offsets[cidrs->list[i].mask + 1]++;
+  for (int mask = 1; mask <= 33; ++mask)
+    offsets[mask] += offsets[mask - 1];
+  for (size_t i = 0; i < cidrs->count; ++i)
+    networks[offsets[cidrs->list[i].mask]++] = cidrs->list[i].network;
+
+  return (networks);
+}
+
+/****
+ *
+ * print kept blocks grouped by mask, smallest mask first
+ *
+ ****/
+
+PRIVATE int printCidrs(struct cidrVector_s *cidrs, struct outputBuf_s **maskOut)
+{
+  uint32_t *networks;
+  size_t offsets[34], i = 0;
+  struct outputBuf_s *out;
+
+  if (cidrs->count EQ 0)
+    return (TRUE);
+
+  if ((networks = groupCidrs(cidrs, offsets)) EQ NULL)
+    return (FAILED);
+
+  i = 0;
+  for (int mask = config->minBits; mask <= config->maxBits; ++mask)
+  {
+    out = (maskOut != NULL) ? maskOut[mask] : output;
+#ifdef DEBUG
+    if (config->debug >= 4)
+    {
+      for (; i < offsets[mask]; ++i)
+        printCidr(out, networks[i], mask);
+      continue;
+    }
+#endif
+    /* one mask is one run of records */
+    writeOutputCidrs(out, networks + i, offsets[mask] - i, mask);
+    i = offsets[mask];
+  }
+
+  XFREE(networks);
+
+  return (TRUE);
+}
+
+/****
+ *
+ * largest whole block at the start of a range, or the part of the range in
+ * its /maxBits block.  returns the end of the piece and sets its mask.
+ *
+ ****/
+
+PRIVATE uint32_t rangePiece(const struct ipv4Range_s *range, int *mask)
+{
+  uint32_t end;
+
+  for (*mask = config->minBits; *mask < config->maxBits; ++*mask)
+    if ((range->start & hostMasks[32 - *mask]) EQ 0 && range->end >= (range->start | hostMasks[32 - *mask]))
+      break;
+  end = range->start | hostMasks[32 - *mask];
+
+  return ((end > range->end) ? range->end : end);
+}
+
+/****
+ *
+ * cut the open run into the largest aligned blocks, which is the fewest
+ * cidrs that cover it exactly
+ *
+ ****/
+
+PRIVATE int aggregateBlocks(struct aggregate_s *agg)
+{
+  uint64_t start = agg->start;
+  int mask;
+
+  while (start <= agg->end)
+  {
+    for (mask = 32; mask > 0 && (start & hostMasks[33 - mask]) EQ 0 && start + hostMasks[33 - mask] <= agg->end; --mask)
+      ;
+
+    if (agg->byMask)
+    {
+      if (addCidrVector(&agg->cidrs, (uint32_t)start, mask) EQ FAILED)
+        return (FAILED);
+    }
+    else if (writeOutputCidr((agg->maskOut != NULL) ? agg->maskOut[mask] : agg->out, (uint32_t)start, mask) EQ FAILED)
+      return (FAILED);
+
+    start += (uint64_t)hostMasks[32 - mask] + 1;
+  }
+  agg->open = FALSE;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * add the next range in start order to the exact cover
+ *
+ * a range that overlaps or touches the open run extends it, so duplicates,
+ * contained prefixes and siblings collapse without another pass.
+ *
+ ****/
+
+PRIVATE int aggregateRange(struct aggregate_s *agg, uint32_t start, uint32_t end)
+{
+  if (agg->open && (uint64_t)start <= agg->end + 1)
+  {
+    if (end > agg->end)
+      agg->end = end;
+    return (TRUE);
+  }
+
+  if (agg->open && aggregateBlocks(agg) EQ FAILED)
+    return (FAILED);
+
+  agg->start = start;
+  agg->end = end;
+  agg->open = TRUE;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * close the last run, blocks grouped by mask are printed smallest mask first
+ *
+ ****/
+
+PRIVATE int finishAggregate(struct aggregate_s *agg)
+{
+  uint32_t *networks;
+  size_t offsets[34], i = 0;
+  int ret = TRUE;
+
+  if (agg->open && aggregateBlocks(agg) EQ FAILED)
+    ret = FAILED;
+
+  if (ret != FAILED && agg->byMask && agg->cidrs.count > 0)
+  {
+    if ((networks = groupCidrs(&agg->cidrs, offsets)) EQ NULL)
+      ret = FAILED;
+    else
+    {
+      for (int mask = 0; mask <= 32; ++mask)
+      {
+        writeOutputCidrs(agg->out, networks + i, offsets[mask] - i, mask);
+        i = offsets[mask];
+      }
+      XFREE(networks);
+    }
+  }
+
+  freeCidrVector(&agg->cidrs);
+
+  return (ret);
+}
+
+/****
+ *
+ * next host from the plain or packed list, FALSE at the end
+ *
+ ****/
+
+PRIVATE int nextListHost(struct networkList_s *netList, struct packCursor_s *cursor, uint32_t *h, uint32_t *host)
+{
+  if (netList->packed != NULL)
+    return (packNext(cursor, host));
+
+  if (*h >= netList->ipv4Count)
+    return (FALSE);
+  *host = netList->ipv4List[(*h)++];
+
+  return (TRUE);
+}
+
+/****
+ *
+ * replace the packed list with the hosts that are outside every kept block
+ *
+ * cidrs are in address order, the skip index jumps over each kept block.
+ *
+ ****/
+
+PRIVATE int packLeftovers(struct networkList_s *netList, struct cidrVector_s *cidrs)
+{
+  struct packedList_s *left;
+  struct packCursor_s cursor;
+  uint32_t host, last;
+  size_t c = 0;
+  int haveHost;
+
+  if ((left = (struct packedList_s *)XMALLOC(sizeof(struct packedList_s))) EQ NULL)
+    return (FAILED);
+  initPackedList(left);
+
+  initPackCursor(&cursor, netList->packed);
+  haveHost = packNext(&cursor, &host);
+  while (haveHost)
+  {
+    while (c < cidrs->count && (cidrs->list[c].network | hostMasks[32 - cidrs->list[c].mask]) < host)
+      c++;
+
+    if (c < cidrs->count && cidrs->list[c].network <= host)
+    {
+      last = cidrs->list[c].network | hostMasks[32 - cidrs->list[c].mask];
+      if (last EQ 0xffffffff)
+        break;
+      packSeek(&cursor, last + 1);
+    }
+    else if (packAppend(left, host) EQ FAILED)
+    {
+      freePackedList(left);
+      XFREE(left);
+      return (FAILED);
+    }
+
+    haveHost = packNext(&cursor, &host);
+  }
+
+  if (finishPackedList(left) EQ FAILED)
+  {
+    freePackedList(left);
+    XFREE(left);
+    return (FAILED);
+  }
+
+  freePackedList(netList->packed);
+  XFREE(netList->packed);
+  netList->packed = left;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * consolidate ipv4 list to cidr blocks
+ *
+ * walks the sorted, unique hosts and ranges once keeping a counter for the
+ * open block at every mask from minBits to maxBits.  a block is kept when
+ * it passes the threshold and no larger block around it does, which is what
+ * consolidating one mask at a time from minBits produces.  what is left
+ * stays in netList for printIPv4List().
+ *
+ ****/
+
+int consolidateIPv4List(struct networkList_s *netList)
+{
+  struct consolidateState_s state;
+  struct ipv4Range_s cur = {0, 0};
+  struct packCursor_s cursor;
+  uint32_t h = 0, r = 0, end, host = 0, *tmpPtr;
+  int mask, haveHost, ret = TRUE;
+
+  /* an empty mask window leaves every address as it is */
+  if (config->minBits > config->maxBits)
+    return (EXIT_SUCCESS);
+
+  initLevelCounts();
+
+  XMEMSET(&state, 0, sizeof(state));
+  state.depth = config->minBits - 1;
+
+  /*
+   * leftovers are written back over the list, a host is only written after
+   * it has been read.  a packed list is decoded as it is walked and only
+   * counts its leftovers.
+   */
+  if (netList->packed != NULL)
+    initPackCursor(&cursor, netList->packed);
+  else
+    state.hosts = netList->ipv4List;
+  haveHost = nextListHost(netList, &cursor, &h, &host);
+
+  if (netList->rangeCount > 0)
+    cur = netList->rangeList[0];
+
+  while ((haveHost || r < netList->rangeCount) && ret != FAILED)
+  {
+    if (r < netList->rangeCount && (!haveHost || cur.start < host))
+    {
+      end = rangePiece(&cur, &mask);
+
+      if ((ret = enterLevels(&state, cur.start, mask)) != FAILED &&
+          (ret = addRangeVector(&state.ranges, cur.start, end)) != FAILED)
+        state.level[mask].count += (uint64_t)end - cur.start + 1;
+
+      if (end EQ cur.end)
+      {
+        if (++r < netList->rangeCount)
+          cur = netList->rangeList[r];
+      }
+      else
+        cur.start = end + 1;
+    }
+    else
+    {
+      if ((ret = enterLevels(&state, host, config->maxBits)) != FAILED)
+      {
+        state.level[config->maxBits].count++;
+        if (state.hosts != NULL)
+          state.hosts[state.hostCount] = host;
+        state.hostCount++;
+      }
+      haveHost = nextListHost(netList, &cursor, &h, &host);
+    }
+  }
+
+  while (state.depth >= config->minBits && ret != FAILED)
+    ret = closeLevel(&state);
+
+  if (ret != FAILED && netList->packed != NULL && (ret = packLeftovers(netList, &state.cidrs)) EQ FAILED)
+    fprintf(stderr, "ERR - Unable to pack leftover addresses\n");
+
+  if (ret EQ FAILED || (config->outputOrder != ORDER_ADDR && printCidrs(&state.cidrs, netList->maskOut) EQ FAILED))
+  {
+    fprintf(stderr, "ERR - Unable to allocate memory for consolidated blocks\n");
+    freeRangeVector(&state.ranges);
+    freeCidrVector(&state.cidrs);
+    return (EXIT_FAILURE);
+  }
+
+  /* in address order the kept blocks are merged with the leftovers when printed */
+  if (config->outputOrder EQ ORDER_ADDR)
+  {
+    freeCidrVector(&netList->cidrs);
+    netList->cidrs = state.cidrs;
+  }
+  else
+    freeCidrVector(&state.cidrs);
+
+  /* switch to the leftover hosts and ranges */
+  if (netList->ipv4List != NULL && state.hostCount EQ 0)
+  {
+    XFREE(netList->ipv4List);
+    netList->ipv4List = NULL;
+  }
+  else if (netList->ipv4List != NULL && state.hostCount < netList->ipv4Count &&
+           (tmpPtr = XREALLOC(netList->ipv4List, state.hostCount * sizeof(uint32_t))) != NULL)
+    netList->ipv4List = tmpPtr;
+  if (netList->rangeList != NULL)
+    XFREE(netList->rangeList);
+
+  netList->ipv4Count = state.hostCount;
+  netList->rangeList = state.ranges.list;
+  netList->rangeCount = mergeRanges(state.ranges.list, state.ranges.count);
+
+  return (EXIT_SUCCESS);
+}
+
+/****
+ *
+ * print the minimal cidr cover of the list
+ *
+ * walks the sorted, unique hosts and ranges once merging every run of
+ * consecutive addresses, no address outside the list is ever added.
+ *
+ ****/
+
+int aggregateIPv4List(struct networkList_s *netList)
+{
+  struct aggregate_s agg;
+  struct packCursor_s cursor;
+  uint32_t h = 0, r = 0, host = 0;
+  int haveHost, ret = TRUE;
+
+  XMEMSET(&agg, 0, sizeof(agg));
+  agg.out = output;
+  agg.maskOut = netList->maskOut;
+  agg.byMask = (netList->maskOut EQ NULL && config->outputOrder != ORDER_ADDR);
+
+  if (netList->packed != NULL)
+    initPackCursor(&cursor, netList->packed);
+  haveHost = nextListHost(netList, &cursor, &h, &host);
+
+  while ((haveHost || r < netList->rangeCount) && ret != FAILED)
+  {
+    if (r < netList->rangeCount && (!haveHost || netList->rangeList[r].start < host))
+    {
+      ret = aggregateRange(&agg, netList->rangeList[r].start, netList->rangeList[r].end);
+      r++;
+    }
+    else
+    {
+      ret = aggregateRange(&agg, host, host);
+      haveHost = nextListHost(netList, &cursor, &h, &host);
+    }
+  }
+
+  if (finishAggregate(&agg) EQ FAILED || ret EQ FAILED)
+  {
+    fprintf(stderr, "ERR - Unable to allocate memory for aggregated blocks\n");
+    return (EXIT_FAILURE);
+  }
+
+  return (EXIT_SUCCESS);
+}
+
+/****
+ *
+ * remove duplicate addresses and overlapping ranges
+ *
+ ****/
+
+int uniqueIPv4List(struct networkList_s *netList)
+{
+  uint32_t *list = netList->ipv4List;
+  struct ipv4Range_s *ranges = netList->rangeList;
+  uint32_t *tmpPtr, newListCount = 0;
+
+  netList->rangeCount = mergeRanges(ranges, netList->rangeCount);
+
+  /* compact unique hosts that are not already inside a range, the write cursor never passes the read cursor */
+  for (uint32_t i = 0, r = 0; i < netList->ipv4Count; ++i)
+  {
+    if (newListCount > 0 && list[i] EQ list[newListCount - 1])
+      continue;
+
+    while (r < netList->rangeCount && ranges[r].end < list[i])
+      r++;
+    if (r < netList->rangeCount && ranges[r].start <= list[i])
+      continue;
+
+    list[newListCount++] = list[i];
+  }
+
+  if (newListCount > 0 && newListCount < netList->ipv4Count)
+  {
+    /* release the unused tail */
+    if ((tmpPtr = XREALLOC(list, newListCount * sizeof(uint32_t))) EQ NULL)
+      fprintf(stderr, "ERR - Unable to allocate memory for new list\n");
+    else
+      netList->ipv4List = tmpPtr;
+  }
+  else if (newListCount EQ 0 && list != NULL)
+  {
+    XFREE(list);
+    netList->ipv4List = NULL;
+  }
+
+  netList->ipv4Count = newListCount;
+
+  return (EXIT_SUCCESS);
+}
+
+/****
+ *
+ * move the sorted, unique hosts into a packed list
+ *
+ ****/
+
+int packIPv4List(struct networkList_s *netList)
+{
+  struct packedList_s *packed;
+
+  if ((packed = (struct packedList_s *)XMALLOC(sizeof(struct packedList_s))) EQ NULL)
+  {
+    fprintf(stderr, "ERR - Unable to allocate memory for packed list\n");
+    return (EXIT_FAILURE);
+  }
+  initPackedList(packed);
+
+  for (uint32_t i = 0; i < netList->ipv4Count; ++i)
+    if (packAppend(packed, netList->ipv4List[i]) EQ FAILED)
+    {
+      freePackedList(packed);
+      XFREE(packed);
+      return (EXIT_FAILURE);
+    }
+
+  if (finishPackedList(packed) EQ FAILED)
+  {
+    freePackedList(packed);
+    XFREE(packed);
+    return (EXIT_FAILURE);
+  }
+
+  if (config->verbose)
+    fprintf(stderr, "Packed [%lu] IPv4 addresses into [%lu] KB\n", (unsigned long)packed->count, (unsigned long)(packedListBytes(packed) / 1024));
+
+  if (netList->ipv4List != NULL)
+    XFREE(netList->ipv4List);
+  netList->ipv4List = NULL;
+  netList->packed = packed;
+
+  return (EXIT_SUCCESS);
+}
+
+/****
+ *
+ * number of addresses in hosts and ranges
+ *
+ ****/
+
+uint64_t countIPv4List(struct networkList_s *netList)
+{
+  uint64_t count = netList->ipv4Count;
+
+  for (uint32_t i = 0; i < netList->rangeCount; ++i)
+    count += (uint64_t)netList->rangeList[i].end - netList->rangeList[i].start + 1;
+
+  return (count);
+}
+
+/****
+ *
+ * free hosts and ranges
+ *
+ ****/
+
+void freeIPv4List(struct networkList_s *netList)
+{
+  if (netList->ipv4List != NULL)
+    XFREE(netList->ipv4List);
+  if (netList->rangeList != NULL)
+    XFREE(netList->rangeList);
+
+  if (netList->packed != NULL)
+  {
+    freePackedList(netList->packed);
+    XFREE(netList->packed);
+  }
+
+  freeCidrVector(&netList->cidrs);
+
+  netList->ipv4List = NULL;
+  netList->rangeList = NULL;
+  netList->packed = NULL;
+  netList->ipv4Count = netList->rangeCount = 0;
+}
+
+/****
+ *
+ * print the hosts and ranges below bound as /32s in address order
+ *
+ ****/
+
+PRIVATE void printListBelow(struct networkList_s *netList, struct listCursor_s *cur, uint64_t bound, struct outputBuf_s *out)
+{
+  size_t lo, hi, mid;
+  uint64_t stop;
+  int haveRange;
+
+  if (netList->packed EQ NULL)
+  {
+    for (;;)
+    {
+      /* the hosts before the next range go out as one run */
+      haveRange = cur->r < netList->rangeCount && netList->rangeList[cur->r].start < bound;
+      stop = haveRange ? (uint64_t)netList->rangeList[cur->r].start + 1 : bound;
+      lo = cur->h;
+      hi = netList->ipv4Count;
+      while (lo < hi)
+      {
+        mid = lo + (hi - lo) / 2;
+        if (netList->ipv4List[mid] < stop)
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+      if (lo > cur->h)
+        writeOutputCidrs(out, netList->ipv4List + cur->h, lo - cur->h, 32);
+      cur->h = lo;
+
+      if (!haveRange)
+        return;
+      for (uint32_t addr = netList->rangeList[cur->r].start;; ++addr)
+      {
+        writeOutputCidr(out, addr, 32);
+        if (addr EQ netList->rangeList[cur->r].end)
+          break;
+      }
+      cur->r++;
+    }
+  }
+
+  while ((cur->haveHost && cur->host < bound) || (cur->r < netList->rangeCount && netList->rangeList[cur->r].start < bound))
+  {
+    if (cur->r < netList->rangeCount && netList->rangeList[cur->r].start < bound && (!cur->haveHost || netList->rangeList[cur->r].start < cur->host))
+    {
+      for (uint32_t addr = netList->rangeList[cur->r].start;; ++addr)
+      {
+        writeOutputCidr(out, addr, 32);
+        if (addr EQ netList->rangeList[cur->r].end)
+          break;
+      }
+      cur->r++;
+    }
+    else
+    {
+      writeOutputCidr(out, cur->host, 32);
+      cur->haveHost = nextListHost(netList, &cur->pack, &cur->h, &cur->host);
+    }
+  }
+}
+
+/****
+ *
+ * print hosts and ranges as /32s in address order
+ *
+ * with --order addr the kept blocks held in netList are merged in, one
+ * already sorted run per mask, so the whole output is in address order.
+ *
+ ****/
+
+void printIPv4List(struct networkList_s *netList, struct outputBuf_s *out)
+{
+  struct listCursor_s cur;
+  uint32_t *networks;
+  size_t offsets[34], pos[33];
+  int mask, best;
+
+  XMEMSET(&cur, 0, sizeof(cur));
+  if (netList->packed != NULL)
+  {
+    initPackCursor(&cur.pack, netList->packed);
+    cur.haveHost = nextListHost(netList, &cur.pack, &cur.h, &cur.host);
+  }
+
+  if (netList->cidrs.count > 0 && (networks = groupCidrs(&netList->cidrs, offsets)) != NULL)
+  {
+    for (mask = 0; mask <= 32; ++mask)
+      pos[mask] = (mask EQ 0) ? 0 : offsets[mask - 1];
+
+    /* k-way merge of the per mask runs, leftovers go out in the gaps */
+    for (;;)
+    {
+      best = -1;
+      for (mask = config->minBits; mask <= config->maxBits; ++mask)
+        if (pos[mask] < offsets[mask] && (best EQ -1 || networks[pos[mask]] < networks[pos[best]]))
+          best = mask;
+      if (best EQ -1)
+        break;
+
+      printListBelow(netList, &cur, networks[pos[best]], out);
+      printCidr(out, networks[pos[best]], best);
+      pos[best]++;
+    }
+
+    XFREE(networks);
+  }
+
+  printListBelow(netList, &cur, (uint64_t)1 << 32, out);
+}
+
+/****
+ *
+ * addresses that fit in the memory limit, the sort needs a second copy
+ *
+ ****/
+
+PRIVATE size_t memLimitAddresses(void)
+{
+  if (config->memLimit EQ 0)
+    return (0);
+
+  if (config->memLimit / (2 * sizeof(uint32_t)) < DEFAULT_VECTOR_SIZE)
+    return (DEFAULT_VECTOR_SIZE);
+
+  return ((size_t)(config->memLimit / (2 * sizeof(uint32_t))));
+}
+
+/****
+ *
+ * sort and dedupe the address buffer, write it out as a run and empty it
+ *
+ ****/
+
+PRIVATE int spillAddrVector(struct addrVector_s *vec, struct extSort_s *ext)
+{
+  size_t count = 0;
+
+  sortIPv4List(vec->list, vec->count);
+
+  for (size_t i = 0; i < vec->count; ++i)
+    if (count EQ 0 || vec->list[i] != vec->list[count - 1])
+      vec->list[count++] = vec->list[i];
+
+  if (spillRun(ext, vec->list, count) EQ FAILED)
+    return (FAILED);
+
+  vec->count = 0;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * make room for one more address, spill a run at the memory limit
+ *
+ ****/
+
+PRIVATE int reserveAddress(struct addrVector_s *vec, struct extSort_s *ext)
+{
+  if (vec->count < vec->size)
+    return (TRUE);
+
+  if (vec->size < vec->maxSize)
+    return (growAddrVector(vec, vec->count + 1));
+
+  if (config->memLimit EQ 0)
+  {
+    fprintf(stderr, "ERR - IPv4 address buffer is full, use --mem-limit to spill to disk\n");
+    return (FAILED);
+  }
+
+  return (spillAddrVector(vec, ext));
+}
+
+/****
+ *
+ * copy a temp file to the output and close it
+ *
+ ****/
+
+PRIVATE void copyTempFile(FILE *fp, struct outputBuf_s *tmpOut)
+{
+  char buf[65536];
+  size_t rCount;
+
+  closeOutput(tmpOut);
+  rewind(fp);
+  while ((rCount = fread(buf, 1, sizeof(buf), fp)) > 0)
+    writeOutput(output, buf, rCount);
+  fclose(fp);
+}
+
+/****
+ *
+ * consolidate spilled runs one /minBits block at a time
+ *
+ * every block at /minBits or smaller lives inside one /minBits block, so
+ * each block is consolidated on its own with the in-memory passes.  the
+ * cidrs for each mask and the leftover hosts go to their own temp files
+ * and are copied to the output in the same order as the in-memory path.
+ * in address order each block is printed as soon as it is consolidated.
+ * the exact cover needs no blocks and is built in one walk of the merge.
+ *
+ ****/
+
+PRIVATE int consolidateExternal(struct extSort_s *ext, struct rangeVector_s *rangeVec)
+{
+  FILE *maskFp[33], *leftFp;
+  struct outputBuf_s *maskOut[33], *leftOut = NULL;
+  struct networkList_s netList;
+  struct addrVector_s chunk;
+  struct aggregate_s agg;
+  uint32_t addr, chunkBase, chunkEnd, rangeStart, rangeCount;
+  uint64_t cursor = 0, chunkCount = 0;
+  int haveAddr, ret = TRUE;
+  int lowMask = config->exact ? 0 : config->minBits, highMask = config->exact ? 32 : config->maxBits;
+  size_t r = 0, chunkRanges;
+
+  if (config->verbose && config->exact)
+    fprintf(stderr, "Merging [%lu] spilled runs into the minimal CIDR cover\n", (unsigned long)ext->runCount);
+  else if (config->verbose)
+    fprintf(stderr, "Merging [%lu] spilled runs and consolidating one /%d at a time\n", (unsigned long)ext->runCount, config->minBits);
+
+  XMEMSET(maskFp, 0, sizeof(maskFp));
+  XMEMSET(maskOut, 0, sizeof(maskOut));
+  leftFp = NULL;
+  if (config->outputOrder EQ ORDER_ADDR)
+  {
+    /* blocks come out in address order, each one goes straight to the output */
+    leftOut = output;
+  }
+  else
+  {
+    for (int mask = lowMask; mask <= highMask; ++mask)
+      if ((maskFp[mask] = createTempFile()) EQ NULL || (maskOut[mask] = openOutput(fileno(maskFp[mask]))) EQ NULL)
+        ret = FAILED;
+    if ((leftFp = createTempFile()) EQ NULL || (leftOut = openOutput(fileno(leftFp))) EQ NULL)
+      ret = FAILED;
+  }
+
+  if (ret EQ FAILED || initAddrVector(&chunk, 0, 0) EQ FAILED)
+  {
+    for (int mask = 0; mask <= 32; ++mask)
+    {
+      if (maskOut[mask] != NULL)
+        closeOutput(maskOut[mask]);
+      if (maskFp[mask] != NULL)
+        fclose(maskFp[mask]);
+    }
+    if (leftFp != NULL)
+    {
+      if (leftOut != NULL)
+        closeOutput(leftOut);
+      fclose(leftFp);
+    }
+    return (FAILED);
+  }
+
+  sortRanges(rangeVec->list, rangeVec->count);
+  rangeCount = mergeRanges(rangeVec->list, rangeVec->count);
+
+  if (startMerge(ext) EQ FAILED)
+    ret = FAILED;
+  haveAddr = (ret != FAILED) && nextMerged(ext, &addr);
+
+  if (config->exact)
+  {
+    XMEMSET(&agg, 0, sizeof(agg));
+    agg.out = output;
+    if (leftFp != NULL)
+      agg.maskOut = maskOut;
+
+    while ((haveAddr || r < rangeCount) && ret != FAILED && !quit)
+    {
+      if (r < rangeCount && (!haveAddr || rangeVec->list[r].start < addr))
+      {
+        ret = aggregateRange(&agg, rangeVec->list[r].start, rangeVec->list[r].end);
+        r++;
+      }
+      else
+      {
+        ret = aggregateRange(&agg, addr, addr);
+        haveAddr = nextMerged(ext, &addr);
+      }
+    }
+
+    if (finishAggregate(&agg) EQ FAILED)
+      ret = FAILED;
+  }
+
+  while ((haveAddr || r < rangeCount) && ret != FAILED && !quit)
+  {
+    /* ranges that span blocks are clipped to the current block */
+    rangeStart = 0;
+    if (r < rangeCount)
+      rangeStart = (rangeVec->list[r].start > cursor) ? rangeVec->list[r].start : (uint32_t)cursor;
+
+    chunkBase = ((haveAddr && (r EQ rangeCount || addr < rangeStart)) ? addr : rangeStart) & netMasks[config->minBits];
+    chunkEnd = chunkBase | hostMasks[32 - config->minBits];
+
+    chunk.count = 0;
+    while (haveAddr && addr <= chunkEnd)
+    {
+      if (chunk.count EQ chunk.size && growAddrVector(&chunk, chunk.count + 1) EQ FAILED)
+      {
+        ret = FAILED;
+        break;
+      }
+      chunk.list[chunk.count++] = addr;
+      haveAddr = nextMerged(ext, &addr);
+    }
+
+    for (chunkRanges = 0; r + chunkRanges < rangeCount && rangeVec->list[r + chunkRanges].start <= chunkEnd; ++chunkRanges)
+      ;
+
+    XMEMSET(&netList, 0, sizeof(netList));
+    netList.maskOut = maskOut;
+    netList.ipv4Count = chunk.count;
+    if (chunk.count > 0)
+    {
+      netList.ipv4List = (uint32_t *)XMALLOC(chunk.count * sizeof(uint32_t));
+      XMEMCPY(netList.ipv4List, chunk.list, chunk.count * sizeof(uint32_t));
+    }
+    netList.rangeCount = chunkRanges;
+    if (chunkRanges > 0)
+    {
+      netList.rangeList = (struct ipv4Range_s *)XMALLOC(chunkRanges * sizeof(struct ipv4Range_s));
+      for (size_t i = 0; i < chunkRanges; ++i)
+      {
+        netList.rangeList[i].start = (rangeVec->list[r + i].start < chunkBase) ? chunkBase : rangeVec->list[r + i].start;
+        netList.rangeList[i].end = (rangeVec->list[r + i].end > chunkEnd) ? chunkEnd : rangeVec->list[r + i].end;
+      }
+
+      /* the last range may continue into the next block */
+      r += chunkRanges;
+      if (rangeVec->list[r - 1].end > chunkEnd)
+        r--;
+    }
+    cursor = (uint64_t)chunkEnd + 1;
+
+    if (uniqueIPv4List(&netList) EQ EXIT_FAILURE)
+      ret = FAILED;
+    if (ret != FAILED && consolidateIPv4List(&netList) EQ EXIT_FAILURE)
+      ret = FAILED;
+    printIPv4List(&netList, leftOut);
+    freeIPv4List(&netList);
+    chunkCount++;
+
+    if (ret EQ FAILED || chunkEnd EQ 0xffffffff)
+      break;
+  }
+
+  /* a run that could not be read ends the merge early */
+  if (ext->failed)
+    ret = FAILED;
+
+  if (config->verbose && !config->exact)
+    fprintf(stderr, "Consolidated [%llu] /%d blocks\n", (unsigned long long)chunkCount, config->minBits);
+
+  freeAddrVector(&chunk);
+
+  if (leftFp != NULL)
+  {
+    for (int mask = lowMask; mask <= highMask; ++mask)
+      copyTempFile(maskFp[mask], maskOut[mask]);
+    copyTempFile(leftFp, leftOut);
+  }
+
+  return (ret);
+}
+
+/****
+ *
+ * print the kept blocks and leftovers of a closed /minBits block in address order
+ *
+ ****/
+
+PRIVATE void flushStream(struct streamState_s *stream)
+{
+  struct consolidateState_s *state = &stream->state;
+  uint64_t bound;
+  uint32_t h = 0;
+  size_t r = 0;
+
+  for (size_t c = 0; c <= state->cidrs.count; ++c)
+  {
+    bound = (c < state->cidrs.count) ? state->cidrs.list[c].network : (uint64_t)1 << 32;
+
+    /* leftovers never overlap a kept block */
+    while ((h < state->hostCount && state->hosts[h] < bound) || (r < state->ranges.count && state->ranges.list[r].start < bound))
+    {
+      if (r < state->ranges.count && state->ranges.list[r].start < bound && (h EQ state->hostCount || state->ranges.list[r].start < state->hosts[h]))
+      {
+        for (uint32_t addr = state->ranges.list[r].start;; ++addr)
+        {
+          writeOutputCidr(output, addr, 32);
+          if (addr EQ state->ranges.list[r].end)
+            break;
+        }
+        r++;
+      }
+      else
+      {
+        writeOutputCidr(output, state->hosts[h++], 32);
+      }
+    }
+
+    if (c < state->cidrs.count)
+      printCidr(output, state->cidrs.list[c].network, state->cidrs.list[c].mask);
+  }
+
+  state->hostCount = 0;
+  state->ranges.count = 0;
+  state->cidrs.count = 0;
+}
+
+/****
+ *
+ * open the blocks for addr, closing and printing the /minBits block before it
+ *
+ ****/
+
+PRIVATE int streamEnter(struct streamState_s *stream, uint32_t addr, int mask)
+{
+  struct consolidateState_s *state = &stream->state;
+
+  if (state->depth >= config->minBits && (addr & netMasks[config->minBits]) != state->level[config->minBits].network)
+  {
+    while (state->depth >= config->minBits)
+      if (closeLevel(state) EQ FAILED)
+        return (FAILED);
+    flushStream(stream);
+  }
+
+  return (enterLevels(state, addr, mask));
+}
+
+/****
+ *
+ * check that start keeps the input in order, FALSE for a duplicate
+ *
+ ****/
+
+PRIVATE int streamOrder(struct streamState_s *stream, uint32_t start, uint32_t end)
+{
+  struct in_addr ip_addr;
+
+  if (stream->next > 0 && start < stream->lastStart)
+  {
+    ip_addr.s_addr = htonl(start);
+    fprintf(stderr, "ERR - Address [%s] is out of order\n", inet_ntoa(ip_addr));
+    return (FAILED);
+  }
+
+  if ((uint64_t)end < stream->next)
+    return (FALSE);
+
+  stream->lastStart = start;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * add the next host of a sorted input
+ *
+ ****/
+
+PRIVATE int streamHost(struct streamState_s *stream, uint32_t addr)
+{
+  struct consolidateState_s *state = &stream->state;
+  uint32_t *tmpPtr;
+  int ret;
+
+  if ((ret = streamOrder(stream, addr, addr)) != TRUE)
+    return (ret);
+  stream->next = (uint64_t)addr + 1;
+
+  if (config->exact)
+    return (aggregateRange(&stream->agg, addr, addr));
+
+  if (config->minBits > config->maxBits)
+  {
+    /* nothing to consolidate */
+    writeOutputCidr(output, addr, 32);
+    return (TRUE);
+  }
+
+  if (streamEnter(stream, addr, config->maxBits) EQ FAILED)
+    return (FAILED);
+
+  if (state->hostCount EQ stream->hostSize)
+  {
+    if ((tmpPtr = XREALLOC(state->hosts, (stream->hostSize + DEFAULT_RANGE_VECTOR_SIZE) * 2 * sizeof(uint32_t))) EQ NULL)
+      return (FAILED);
+    state->hosts = tmpPtr;
+    stream->hostSize = (stream->hostSize + DEFAULT_RANGE_VECTOR_SIZE) * 2;
+  }
+
+  state->level[config->maxBits].count++;
+  state->hosts[state->hostCount++] = addr;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * add the next range of a sorted input
+ *
+ ****/
+
+PRIVATE int streamRange(struct streamState_s *stream, uint32_t start, uint32_t end)
+{
+  struct consolidateState_s *state = &stream->state;
+  struct ipv4Range_s cur;
+  uint32_t pieceEnd;
+  int mask, ret;
+
+  if ((ret = streamOrder(stream, start, end)) != TRUE)
+    return (ret);
+
+  /* skip what an earlier entry already covered */
+  cur.start = ((uint64_t)start < stream->next) ? (uint32_t)stream->next : start;
+  cur.end = end;
+  stream->next = (uint64_t)end + 1;
+
+  if (config->exact)
+    return (aggregateRange(&stream->agg, cur.start, cur.end));
+
+  if (config->minBits > config->maxBits)
+  {
+    for (uint32_t addr = cur.start;; ++addr)
+    {
+      writeOutputCidr(output, addr, 32);
+      if (addr EQ cur.end)
+        return (TRUE);
+    }
+  }
+
+  for (;;)
+  {
+    pieceEnd = rangePiece(&cur, &mask);
+
+    if (streamEnter(stream, cur.start, mask) EQ FAILED || addRangeVector(&state->ranges, cur.start, pieceEnd) EQ FAILED)
+      return (FAILED);
+    state->level[mask].count += (uint64_t)pieceEnd - cur.start + 1;
+
+    if (pieceEnd EQ cur.end)
+      return (TRUE);
+    cur.start = pieceEnd + 1;
+  }
+}
+
+/****
+ *
+ * close and print the last open block
+ *
+ ****/
+
+PRIVATE int finishStream(struct streamState_s *stream)
+{
+  struct consolidateState_s *state = &stream->state;
+
+  if (config->exact)
+    return (finishAggregate(&stream->agg));
+
+  while (state->depth >= config->minBits)
+    if (closeLevel(state) EQ FAILED)
+      return (FAILED);
+  flushStream(stream);
+
+  return (TRUE);
+}
+
+/****
+ *
+ * free the stream buffers
+ *
+ ****/
+
+PRIVATE void freeStream(struct streamState_s *stream)
+{
+  if (stream->state.hosts != NULL)
+    XFREE(stream->state.hosts);
+  freeRangeVector(&stream->state.ranges);
+  freeCidrVector(&stream->state.cidrs);
+  freeCidrVector(&stream->agg.cidrs);
+  XMEMSET(stream, 0, sizeof(struct streamState_s));
+}
+
+/****
+ *
+ * init the address set for the configured engine
+ *
+ ****/
+
+PRIVATE int initAddrSet(struct addrSet_s *set, off_t inputSize)
+{
+  XMEMSET(set, 0, sizeof(struct addrSet_s));
+
+  if (config->sortedInput)
+  {
+    /* only the open /minBits block is held */
+    initLevelCounts();
+    set->stream.state.depth = config->minBits - 1;
+    set->stream.agg.out = output;
+    return (TRUE);
+  }
+
+  if (config->engine EQ ENGINE_TRIE)
+  {
+    initTrie(&set->trie);
+    return (TRUE);
+  }
+
+  if (config->engine EQ ENGINE_BITMAP || config->engine EQ ENGINE_SPARSE)
+    return (initBitmap(&set->bitmap, config->engine EQ ENGINE_SPARSE));
+
+  if (config->engine EQ ENGINE_ROARING)
+    return (initRoaring(&set->roaring));
+
+  /* size the address buffer from the input, it grows by doubling up to the memory limit */
+  return (initAddrVector(&set->addrVec, inputSize, memLimitAddresses()));
+}
+
+/****
+ *
+ * add a host address to the set
+ *
+ ****/
+
+PRIVATE int addSetHost(struct addrSet_s *set, uint32_t addr)
+{
+  if (config->sortedInput)
+    return (streamHost(&set->stream, addr));
+
+  if (set->pipe != NULL)
+    return (pipeHost(set->pipe, addr));
+
+  if (config->engine EQ ENGINE_TRIE)
+    return (trieInsert(&set->trie, addr, 32));
+
+  if (config->engine EQ ENGINE_BITMAP || config->engine EQ ENGINE_SPARSE)
+    return (bitmapSet(&set->bitmap, addr));
+
+  if (config->engine EQ ENGINE_ROARING)
+    return (roaringAdd(&set->roaring, addr));
+
+  if (reserveAddress(&set->addrVec, &set->extSort) EQ FAILED)
+    return (FAILED);
+  set->addrVec.list[set->addrVec.count++] = addr;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * add a cidr block to the set
+ *
+ ****/
+
+PRIVATE int addSetCidr(struct addrSet_s *set, uint32_t network, int mask)
+{
+  if (config->sortedInput)
+    return (streamRange(&set->stream, network, network | hostMasks[32 - mask]));
+
+  if (config->engine EQ ENGINE_TRIE)
+    return (trieInsert(&set->trie, network, mask));
+
+  if (config->engine EQ ENGINE_BITMAP || config->engine EQ ENGINE_SPARSE)
+    return (bitmapSetRange(&set->bitmap, network, network | hostMasks[32 - mask]));
+
+  if (config->engine EQ ENGINE_ROARING)
+    return (roaringAddRange(&set->roaring, network, network | hostMasks[32 - mask]));
+
+  return (addRangeVector(&set->rangeVec, network, network | hostMasks[32 - mask]));
+}
+
+/****
+ *
+ * consolidate and print a set held by one of the alternate engines
+ *
+ ****/
+
+PRIVATE int consolidateAddrSet(struct addrSet_s *set)
+{
+  struct cidrVector_s cidrs = {NULL, 0, 0};
+  struct rangeVector_s ranges = {NULL, 0, 0};
+  struct addrVector_s hosts;
+  struct networkList_s netList;
+  uint32_t containers[CONTAINER_RUN + 1];
+  uint64_t bytes;
+  int ret = TRUE;
+
+  initLevelCounts();
+
+  /* settle every container on its smallest form before counting */
+  if (config->engine EQ ENGINE_ROARING && roaringOptimize(&set->roaring) EQ FAILED)
+    return (FAILED);
+
+  if (initAddrVector(&hosts, 0, 0) EQ FAILED)
+    return (FAILED);
+
+  if (config->verbose)
+  {
+    if (config->engine EQ ENGINE_TRIE)
+      fprintf(stderr, "Trie holds [%llu] addresses in [%llu] nodes\n", (unsigned long long)((set->trie.root != NULL) ? set->trie.root->population : 0), (unsigned long long)set->trie.nodeCount);
+    else if (config->engine EQ ENGINE_SPARSE)
+      fprintf(stderr, "Sparse bitmap holds [%lu] /16 leaves [%lu KB]\n", (unsigned long)set->bitmap.leafCount, (unsigned long)set->bitmap.leafCount * BITMAP_CHUNK_WORDS * sizeof(uint64_t) / 1024);
+    else if (config->engine EQ ENGINE_ROARING)
+    {
+      bytes = roaringSize(&set->roaring, containers);
+      fprintf(stderr, "Roaring set holds [%u] array, [%u] bitmap and [%u] run containers [%llu KB]\n", containers[CONTAINER_ARRAY], containers[CONTAINER_BITMAP], containers[CONTAINER_RUN], (unsigned long long)bytes / 1024);
+    }
+    fprintf(stderr, "Consolidating /%d through /%d\n", config->minBits, config->maxBits);
+  }
+
+  if (config->engine EQ ENGINE_TRIE)
+    ret = consolidateTrie(&set->trie, levelMinCount, config->minBits, config->maxBits, &cidrs, &hosts, &ranges);
+  else if (config->engine EQ ENGINE_ROARING)
+    ret = consolidateRoaring(&set->roaring, levelMinCount, config->minBits, config->maxBits, &cidrs, &hosts, &ranges);
+  else
+    ret = consolidateBitmap(&set->bitmap, levelMinCount, config->minBits, config->maxBits, &cidrs, &hosts, &ranges);
+
+  if (ret EQ FAILED || (config->outputOrder != ORDER_ADDR && printCidrs(&cidrs, NULL) EQ FAILED))
+    ret = FAILED;
+  else
+  {
+    if (config->verbose)
+      fprintf(stderr, "Sending remaining IP addresses to output\n");
+
+    XMEMSET(&netList, 0, sizeof(netList));
+    netList.ipv4List = hosts.list;
+    netList.ipv4Count = hosts.count;
+    netList.rangeList = ranges.list;
+    netList.rangeCount = mergeRanges(ranges.list, ranges.count);
+    if (config->outputOrder EQ ORDER_ADDR)
+      netList.cidrs = cidrs;
+    printIPv4List(&netList, output);
+  }
+
+  freeCidrVector(&cidrs);
+  freeAddrVector(&hosts);
+  freeRangeVector(&ranges);
+
+  return (ret);
+}
+
+/****
+ *
+ * free the address set
+ *
+ ****/
+
+PRIVATE void freeAddrSet(struct addrSet_s *set)
+{
+  freeAddrVector(&set->addrVec);
+  freeRangeVector(&set->rangeVec);
+  freeExtSort(&set->extSort);
+  freeTrie(&set->trie);
+  freeBitmap(&set->bitmap);
+  freeRoaring(&set->roaring);
+  freeStream(&set->stream);
+  if (set->radixHist != NULL)
+    XFREE(set->radixHist);
+  set->radixHist = NULL;
 }
@@ -57,6 +57,16 @@
 #include "util.h"
 #include "mem.h"
 #include "sort.h"
+#include "input.h"
+#include "parse.h"
+#include "vector.h"
+#include "extsort.h"
+#include "trie.h"
+#include "bitmap.h"
+#include "roaring.h"
+#include "packlist.h"
+#include "ring.h"
+#include "output.h"
 
 /****
  *
@@ -66,6 +76,33 @@
 
 #define LINEBUF_SIZE 4096
 
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_OPEN_MEMSTREAM)
+#define HAVE_PARALLEL_PARSE 1
+#endif
+
+/* smallest chunk of a file worth a parse thread */
+#define PARSE_CHUNK_MIN (16 * 1024 * 1024)
+
+#ifdef HAVE_PTHREAD_H
+#define HAVE_PIPELINE 1
+#endif
+
+/* read buffers and address batches in flight between pipeline stages */
+#define PIPE_BUFFERS 8
+#define PIPE_BATCHES 16
+#define PIPE_BATCH_SIZE 4096
+
+/* address set engines */
+#define ENGINE_LIST 0
+#define ENGINE_TRIE 1
+#define ENGINE_BITMAP 2
+#define ENGINE_SPARSE 3
+#define ENGINE_ROARING 4
+
+/* output order */
+#define ORDER_MASK 0
+#define ORDER_ADDR 1
+
 #define MASK_23 0xfffffe00
 #define MASK_24 0xffffff00
 #define MASK_25 0xffffff80
@@ -93,8 +130,129 @@ struct networkList_s
 {
   uint32_t *ipv4List;
   uint64_t *ipv6List;
+  struct ipv4Range_s *rangeList;
+  struct outputBuf_s **maskOut;
+  struct packedList_s *packed;
+  struct cidrVector_s cidrs;
   uint32_t ipv4Count;
   uint32_t ipv6Count;
+  uint32_t rangeCount;
+};
+
+/* position in the leftovers of a list while printing */
+struct listCursor_s
+{
+  struct packCursor_s pack;
+  uint32_t h;
+  uint32_t r;
+  uint32_t host;
+  int haveHost;
+};
+
+/* open block at one mask while consolidating */
+struct consolidateLevel_s
+{
+  uint32_t network;
+  uint64_t count;
+  size_t cidrMark;
+  uint32_t hostMark;
+  size_t rangeMark;
+};
+
+struct consolidateState_s
+{
+  struct consolidateLevel_s level[33];
+  int depth;
+  uint32_t *hosts;
+  uint32_t hostCount;
+  struct rangeVector_s ranges;
+  struct cidrVector_s cidrs;
+};
+
+/*
+ * open run of consecutive addresses for --exact, cut into the largest
+ * aligned blocks when the next address does not extend it.  blocks go to
+ * maskOut[mask] or out, or are kept in cidrs when byMask groups them.
+ */
+struct aggregate_s
+{
+  uint64_t start;
+  uint64_t end;
+  int open;
+  int byMask;
+  struct outputBuf_s *out;
+  struct outputBuf_s **maskOut;
+  struct cidrVector_s cidrs;
+};
+
+/* sorted input consolidated as it is read, one /minBits block at a time */
+struct streamState_s
+{
+  struct consolidateState_s state;
+  struct aggregate_s agg;
+  uint32_t hostSize;
+  uint32_t lastStart;
+  uint64_t next;
+};
+
+/* parsed addresses, held the way the configured engine wants them */
+struct addrSet_s
+{
+  struct pipeline_s *pipe;
+  size_t *radixHist;
+  struct addrVector_s addrVec;
+  struct rangeVector_s rangeVec;
+  struct extSort_s extSort;
+  struct trie_s trie;
+  struct bitmap_s bitmap;
+  struct roaring_s roaring;
+  struct streamState_s stream;
+};
+
+/* one chunk of a file being parsed on its own thread */
+struct parseWorker_s
+{
+  struct inputFile_s chunk;
+  struct addrSet_s set;
+  struct outputBuf_s *out;
+  char *logBuf;
+  size_t logLen;
+  int ret;
+};
+
+/* lines read from a pipe, the reader thread keeps them whole */
+struct pipeBuffer_s
+{
+  char *data;
+  size_t size;
+  size_t len;
+};
+
+struct addrBatch_s
+{
+  size_t count;
+  uint32_t list[PIPE_BATCH_SIZE];
+};
+
+/*
+ * reader thread -> parser -> sorter thread.  full buffers and batches go
+ * down the pipeline and empty ones come back on a second ring.
+ */
+struct pipeline_s
+{
+  struct inputFile_s *inFile;
+  struct addrSet_s *set;
+  struct spscRing_s fullBuffers;
+  struct spscRing_s freeBuffers;
+  struct spscRing_s fullBatches;
+  struct spscRing_s freeBatches;
+  struct pipeBuffer_s buffers[PIPE_BUFFERS];
+  struct addrBatch_s *batches;
+  struct addrBatch_s *batch;
+  char *carry;
+  size_t carryLen;
+  size_t carrySize;
+  int sortFailed;
 };
 
 /****
@@ -104,7 +262,12 @@ struct networkList_s
  ****/
 
 int processFile(const char *fName);
-int consolidateIPv4List(struct networkList_s *netList, uint32_t mask);
+int consolidateIPv4List(struct networkList_s *netList);
+int aggregateIPv4List(struct networkList_s *netList);
 int uniqueIPv4List(struct networkList_s *netList);
+int packIPv4List(struct networkList_s *netList);
+uint64_t countIPv4List(struct networkList_s *netList);
+void freeIPv4List(struct networkList_s *netList);
+void printIPv4List(struct networkList_s *netList, struct outputBuf_s *out);
 
 #endif /* IP2CIDR_DOT_H */
@@ -56,6 +56,7 @@
 PUBLIC int quit = FALSE;
 PUBLIC int reload = FALSE;
 PUBLIC Config_t *config = NULL;
+PUBLIC struct outputBuf_s *output = NULL;
 
 /****
  *
@@ -75,6 +76,9 @@ extern char **environ;
 int main(int argc, char *argv[])
 {
   PRIVATE int c = 0;
+  int ret = EXIT_SUCCESS;
+  int outFd = STDOUT_FILENO;
+  char *outPath = NULL;
 
 #ifndef DEBUG
 # ifndef MINGW
@@ -103,15 +107,28 @@ int main(int argc, char *argv[])
     static struct option long_options[] = {
         {"verbose", no_argument, 0, 'V'},
                 {"version", no_argument, 0, 'v'},
+        {"compress", no_argument, 0, 'c'},
         {"debug", required_argument, 0, 'd'},
+        {"engine", required_argument, 0, 'e'},
+        {"exact", no_argument, 0, 'x'},
+        {"format", required_argument, 0, 'f'},
         {"help", no_argument, 0, 'h'},
+        {"input", required_argument, 0, 'i'},
         {"hbit", required_argument, 0, 'H'},
         {"lbit", required_argument, 0, 'l'},
+        {"mem-limit", required_argument, 0, 'm'},
+        {"maxelem", required_argument, 0, 'M'},
+        {"name", required_argument, 0, 'N'},
+        {"output", required_argument, 0, 'o'},
+        {"order", required_argument, 0, 'O'},
+        {"sort", required_argument, 0, 's'},
+        {"sorted-input", no_argument, 0, 'S'},
         {"thold", required_argument, 0, 't'},
+        {"threads", required_argument, 0, 'T'},
         {0, no_argument, 0, 0}};
-    c = getopt_long(argc, argv, "Vvd:hH:l:t:", long_options, &option_index);
+    c = getopt_long(argc, argv, "Vvcd:e:f:hH:i:l:m:M:N:o:O:s:St:T:x", long_options, &option_index);
 #else
-    c = getopt(argc, argv, "Vvd:hH:l:t:");
+    c = getopt(argc, argv, "Vvcd:e:f:hH:i:l:m:M:N:o:O:s:St:T:x");
 #endif
 
     if (c EQ - 1)
@@ -130,11 +147,56 @@ int main(int argc, char *argv[])
       config->verbose = TRUE;
       break;
       
+    case 'c':
+      /* pack the sorted address list */
+      config->compress = TRUE;
+      break;
+
     case 'd':
       /* show debig info */
       config->debug = atoi(optarg);
       break;
 
+    case 'e':
+      /* address set engine */
+      if (strcmp(optarg, "list") EQ 0)
+        config->engine = ENGINE_LIST;
+      else if (strcmp(optarg, "trie") EQ 0)
+        config->engine = ENGINE_TRIE;
+      else if (strcmp(optarg, "bitmap") EQ 0)
+        config->engine = ENGINE_BITMAP;
+      else if (strcmp(optarg, "sparse") EQ 0)
+        config->engine = ENGINE_SPARSE;
+      else if (strcmp(optarg, "roaring") EQ 0)
+        config->engine = ENGINE_ROARING;
+      else
+      {
+        fprintf(stderr, "ERR - Unknown engine [%s]\n", optarg);
+        print_help();
+        return (EXIT_FAILURE);
+      }
+      break;
+
+    case 'f':
+      /* output format */
+      if (strcmp(optarg, "plain") EQ 0)
+        config->outputFormat = FORMAT_PLAIN;
+      else if (strcmp(optarg, "ipset") EQ 0)
+        config->outputFormat = FORMAT_IPSET;
+      else if (strcmp(optarg, "nft") EQ 0)
+        config->outputFormat = FORMAT_NFT;
+      else if (strcmp(optarg, "iptables") EQ 0)
+        config->outputFormat = FORMAT_IPTABLES;
+      else if (strcmp(optarg, "pf") EQ 0)
+        config->outputFormat = FORMAT_PF;
+      else
+      {
+        fprintf(stderr, "ERR - Unknown output format [%s]\n", optarg);
+        print_help();
+        return (EXIT_FAILURE);
+      }
+      break;
+
     case 'h':
       /* show help info */
       print_help();
@@ -145,16 +207,110 @@ int main(int argc, char *argv[])
       config->maxBits = atoi(optarg);
       break;
 
+    case 'i':
+      /* how regular files are read */
+      if (strcmp(optarg, "mmap") EQ 0)
+        config->inputMethod = INPUT_MMAP;
+      else if (strcmp(optarg, "read") EQ 0)
+        config->inputMethod = INPUT_READ;
+      else if (strcmp(optarg, "uring") EQ 0)
+        config->inputMethod = INPUT_URING;
+      else
+      {
+        fprintf(stderr, "ERR - Unknown input method [%s]\n", optarg);
+        print_help();
+        return (EXIT_FAILURE);
+      }
+      break;
+
     case 'l':
       /* min network bits */
       config->minBits = atoi(optarg);
       break;
 
+    case 'm':
+      /* memory limit for the address list in MB */
+      if (atoi(optarg) < 1)
+      {
+        fprintf(stderr, "ERR - Memory limit must be at least 1 MB\n");
+        return (EXIT_FAILURE);
+      }
+      config->memLimit = (uint64_t)atoi(optarg) * 1024 * 1024;
+      break;
+
+    case 'M':
+      /* ipset maxelem */
+      config->maxElem = strtoull(optarg, NULL, 10);
+      if (config->maxElem < 1 || config->maxElem > IPSET_MAX_MAXELEM)
+      {
+        fprintf(stderr, "ERR - Maxelem must be between 1 and %llu\n", (unsigned long long)IPSET_MAX_MAXELEM);
+        return (EXIT_FAILURE);
+      }
+      break;
+
+    case 'N':
+      /* set or chain name for the loader formats */
+      config->setName = optarg;
+      break;
+
+    case 'o':
+      /* write to a file instead of stdout, opened once every option checks out */
+      outPath = optarg;
+      break;
+
+    case 'O':
+      /* output order */
+      if (strcmp(optarg, "mask") EQ 0)
+        config->outputOrder = ORDER_MASK;
+      else if (strcmp(optarg, "addr") EQ 0)
+        config->outputOrder = ORDER_ADDR;
+      else
+      {
+        fprintf(stderr, "ERR - Unknown output order [%s]\n", optarg);
+        print_help();
+        return (EXIT_FAILURE);
+      }
+      break;
+
+    case 's':
+      /* sort algorithm */
+      if (strcmp(optarg, "radix") EQ 0)
+        config->sortType = SORT_RADIX;
+      else if (strcmp(optarg, "quick") EQ 0)
+        config->sortType = SORT_QUICK;
+      else
+      {
+        fprintf(stderr, "ERR - Unknown sort algorithm [%s]\n", optarg);
+        print_help();
+        return (EXIT_FAILURE);
+      }
+      break;
+
+    case 'S':
+      /* input is already sorted, consolidate as it is read */
+      config->sortedInput = TRUE;
+      break;
+
     case 't':
       /* consolidation threshold */
       config->threshold = atof(optarg) / 100;
       break;
 
+    case 'T':
+      /* worker threads */
+      config->threads = atoi(optarg);
+      if (config->threads < 1 || config->threads > MAX_THREADS)
+      {
+        fprintf(stderr, "ERR - Thread count must be between 1 and %d\n", MAX_THREADS);
+        return (EXIT_FAILURE);
+      }
+      break;
+
+    case 'x':
+      /* minimal cidr cover instead of threshold consolidation */
+      config->exact = TRUE;
+      break;
+
     default:
       fprintf(stderr, "Unknown option code [0%o]\n", c);
     }
@@ -170,6 +326,60 @@ int main(int argc, char *argv[])
   if (config->maxBits EQ 0)
     config->maxBits = DEFAULT_MAX_BITS;
 
+  if (config->sortType EQ SORT_DEFAULT)
+    config->sortType = SORT_RADIX;
+
+  /* ipset stops adding at maxelem, size it from the input unless told */
+  if (config->outputFormat EQ FORMAT_IPSET && config->maxElem EQ 0)
+    config->maxElem = estimateMaxElem(argc, argv, optind);
+
+  /* the exact cover is one walk of the sorted list */
+  if (config->exact && config->engine != ENGINE_LIST)
+  {
+    fprintf(stderr, "ERR - Exact aggregation only works with the list engine\n");
+    return (EXIT_FAILURE);
+  }
+
+  /* packing, spilling and streaming all work on the sorted list */
+  if (config->engine != ENGINE_LIST && (config->compress || config->memLimit > 0 || config->sortedInput))
+  {
+    fprintf(stderr, "ERR - %s only works with the list engine\n", config->compress ? "Packing (-c)" : (config->memLimit > 0) ? "Memory limit (-m)" : "Sorted input (-S)");
+    return (EXIT_FAILURE);
+  }
+
+  /* one thread per online cpu unless told otherwise */
+  if (config->threads EQ 0)
+  {
+#ifdef _SC_NPROCESSORS_ONLN
+    config->threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (config->threads < 1)
+      config->threads = 1;
+    else if (config->threads > MAX_THREADS)
+      config->threads = MAX_THREADS;
+  }
+
+  /* pick the address parser for this cpu */
+  initParser();
+
+  /* and the sort kernels */
+  initSort();
+
+  /* everything written to the output goes through one buffer */
+  if (initOutput(argc - optind) EQ FAILED)
+    return (EXIT_FAILURE);
+  if (outPath != NULL && (outFd = open(outPath, O_RDWR | O_CREAT | O_TRUNC, 0644)) EQ FAILED)
+  {
+    fprintf(stderr, "ERR - Unable to open output file [%s] %d (%s)\n", outPath, errno, strerror(errno));
+    return (EXIT_FAILURE);
+  }
+  if ((output = openOutput(outFd)) EQ NULL)
+  {
+    fprintf(stderr, "ERR - Unable to allocate output buffer\n");
+    return (EXIT_FAILURE);
+  }
+  writeOutputHeader(output);
+
   /*
    * get to work
    */
@@ -177,7 +387,19 @@ int main(int argc, char *argv[])
   /* process all the files */
   while (optind < argc)
   {
-    processFile(argv[optind++]);
+    if (processFile(argv[optind++]) != EXIT_SUCCESS)
+      ret = EXIT_FAILURE;
+  }
+
+  writeOutputFooter(output);
+  if (closeOutput(output) EQ FAILED)
+    ret = EXIT_FAILURE;
+  output = NULL;
+  freeOutput();
+  if (outFd != STDOUT_FILENO && close(outFd) EQ FAILED)
+  {
+    fprintf(stderr, "ERR - Unable to close output file %d (%s)\n", errno, strerror(errno));
+    ret = EXIT_FAILURE;
   }
 
   /*
@@ -186,7 +408,7 @@ int main(int argc, char *argv[])
 
   cleanup();
 
-  return (EXIT_SUCCESS);
+  return (ret);
 }
 
 /****
@@ -232,28 +454,81 @@ PRIVATE void print_help(void)
   fprintf(stderr, "syntax: %s [options] filename [filename ...]\n", PACKAGE);
 
 #ifdef HAVE_GETOPT_LONG
+  fprintf(stderr, " -c|--compress          pack the sorted address list to save memory\n");
   fprintf(stderr, " -d|--debug (0-9)       enable debugging info\n");
+  fprintf(stderr, " -e|--engine {engine}   address set engine, list, trie, bitmap, sparse or roaring (default: list)\n");
+  fprintf(stderr, " -f|--format {format}   output format, plain, ipset, nft, iptables or pf (default: plain)\n");
   fprintf(stderr, " -h|--help              this info\n");
   fprintf(stderr, " -H|--hbit {bits}       max network bits (default: 31)\n");
+  fprintf(stderr, " -i|--input {method}    read files with mmap, read or uring (default: mmap)\n");
   fprintf(stderr, " -l|--lbit {bits}       min network bits (default: 24)\n");
+  fprintf(stderr, " -m|--mem-limit {MB}    spill sorted runs to disk past this size\n");
+  fprintf(stderr, " -M|--maxelem {count}   ipset maxelem (default: sized from the input)\n");
+  fprintf(stderr, " -N|--name {name}       set or chain name for -f (default: ip2cidr)\n");
+  fprintf(stderr, " -o|--output {file}     write to file instead of stdout\n");
+  fprintf(stderr, " -O|--order {order}     output order, mask or addr (default: mask)\n");
+  fprintf(stderr, " -s|--sort {alg}        sort algorithm, radix or quick (default: radix)\n");
+  fprintf(stderr, " -S|--sorted-input      input is sorted, consolidate while reading\n");
   fprintf(stderr, " -t|--thold {percent}   consolidation threshold (default: 51)\n");
+  fprintf(stderr, " -T|--threads {count}   worker threads (default: online cpus)\n");
   fprintf(stderr, " -v|--version           display version information\n");
   fprintf(stderr, " -V|--verbose           show additional information\n");
+  fprintf(stderr, " -x|--exact             minimal CIDR cover, no addresses added\n");
   fprintf(stderr, " filename               one or more files to process, use '-' to read from stdin\n");
 #else
+  fprintf(stderr, " -c             pack the sorted address list to save memory\n");
   fprintf(stderr, " -d {lvl}       enable debugging info\n");
+  fprintf(stderr, " -e {engine}    address set engine, list, trie, bitmap, sparse or roaring (default: list)\n");
+  fprintf(stderr, " -f {format}    output format, plain, ipset, nft, iptables or pf (default: plain)\n");
   fprintf(stderr, " -h             this info\n");
   fprintf(stderr, " -H {bits}      max network bits (default: 31)\n");
+  fprintf(stderr, " -i {method}    read files with mmap, read or uring (default: mmap)\n");
   fprintf(stderr, " -l {bits}      min network bits (default: 24)\n");
+  fprintf(stderr, " -m {MB}        spill sorted runs to disk past this size\n");
+  fprintf(stderr, " -M {count}     ipset maxelem (default: sized from the input)\n");
+  fprintf(stderr, " -N {name}      set or chain name for -f (default: ip2cidr)\n");
+  fprintf(stderr, " -o {file}      write to file instead of stdout\n");
+  fprintf(stderr, " -O {order}     output order, mask or addr (default: mask)\n");
+  fprintf(stderr, " -s {alg}       sort algorithm, radix or quick (default: radix)\n");
+  fprintf(stderr, " -S             input is sorted, consolidate while reading\n");
   fprintf(stderr, " -t {percent}   consolidation threshold (default: 51)\n");
+  fprintf(stderr, " -T {count}     worker threads (default: online cpus)\n");
   fprintf(stderr, " -v             display version information\n");
   fprintf(stderr, " -V             show additional information\n");
+  fprintf(stderr, " -x             minimal CIDR cover, no addresses added\n");
   fprintf(stderr, " filename       one or more files to process, use '-' to read from stdin\n");
 #endif
 
   fprintf(stderr, "\n");
 }
 
+/****
+ *
+ * most records the input files can produce, one per shortest line
+ *
+ ****/
+
+PRIVATE uint64_t estimateMaxElem(int argc, char *argv[], int first)
+{
+  struct stat sb;
+  uint64_t total = 0;
+
+  for (int i = first; i < argc; ++i)
+  {
+    /* stdin and pipes can hold anything */
+    if (strcmp(argv[i], "-") EQ 0 || stat(argv[i], &sb) EQ FAILED || !S_ISREG(sb.st_mode))
+      return (IPSET_DEFAULT_MAXELEM);
+    total += (uint64_t)sb.st_size / IPSET_MIN_LINE + 1;
+  }
+
+  if (total < IPSET_MIN_MAXELEM)
+    return (IPSET_MIN_MAXELEM);
+  if (total > IPSET_MAX_MAXELEM)
+    return (IPSET_MAX_MAXELEM);
+
+  return (total);
+}
+
 /****
  *
  * cleanup
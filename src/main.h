@@ -49,6 +49,7 @@
 #define DEFAULT_THRESHOLD 0.51
 #define DEFAULT_MIN_BITS 24
 #define DEFAULT_MAX_BITS 31
+#define MAX_THREADS 256
 
 /****
  *
@@ -93,6 +94,7 @@ int main(int argc, char *argv[]);
 PRIVATE void print_version( void );
 PRIVATE void print_help( void );
 PRIVATE void cleanup( void );
+PRIVATE uint64_t estimateMaxElem(int argc, char *argv[], int first);
 PRIVATE void show_info( void );
 void ctime_prog( int signo );
 
@@ -0,0 +1,795 @@
+/*****
+ *
+ * Description: Buffered Output Writer
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "output.h"
+
+/****
+ *
+ * local variables
+ *
+ ****/
+
+/* decimal text of every octet and of every "/mask" suffix, NUL padded to 4 bytes */
+PRIVATE char octetText[256][4];
+PRIVATE uint8_t octetLen[256];
+PRIVATE char maskText[33][4];
+PRIVATE uint8_t maskLen[33];
+
+/* set or chain the records go in, nft splits off the table in front */
+PRIVATE char tableName[OUTPUT_NAME_MAX + 1];
+PRIVATE char setName[OUTPUT_NAME_MAX + 1];
+
+/* text around every record and around every chunk of records */
+PRIVATE char recordPrefix[OUTPUT_AFFIX_MAX];
+PRIVATE char recordSuffix[OUTPUT_AFFIX_MAX];
+PRIVATE char chunkOpen[OUTPUT_AFFIX_MAX];
+PRIVATE size_t chunkOpenLen;
+PRIVATE const char chunkClose[] = "}\n";
+
+/*
+ * nft records already written.  an interval set command must not name an
+ * element twice, and repeated input CIDRs or overlapping input files would.
+ * one file only repeats the CIDRs passed through above the min bitmask, so
+ * every record is only tracked with more than one file.  open addressing
+ * on network << 8 | (mask + 1), 0 marks an empty slot.
+ */
+PRIVATE int seenAll;
+PRIVATE uint64_t *seenKeys;
+PRIVATE size_t seenSize;
+PRIVATE size_t seenCount;
+#ifdef HAVE_PTHREAD_H
+PRIVATE pthread_mutex_t seenLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/****
+ *
+ * external variables
+ *
+ ****/
+
+extern int errno;
+extern Config_t *config;
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * check the set name and split the nft table off the front of it
+ *
+ ****/
+
+PRIVATE int parseSetName(const char *name)
+{
+  const char *space;
+  size_t len = strlen(name);
+
+  if (len EQ 0 || len > OUTPUT_NAME_MAX)
+  {
+    fprintf(stderr, "ERR - Set name must be 1 to %d characters [%s]\n", OUTPUT_NAME_MAX, name);
+    return (FAILED);
+  }
+
+  for (const char *p = name; *p; ++p)
+    if (!isalnum((unsigned char)*p) && *p != '_' && *p != '-' && *p != '.' && (*p != ' ' || config->outputFormat != FORMAT_NFT))
+    {
+      fprintf(stderr, "ERR - Invalid character in set name [%s]\n", name);
+      return (FAILED);
+    }
+
+  if ((space = strrchr(name, ' ')) EQ NULL)
+  {
+    snprintf(tableName, sizeof(tableName), "%s", OUTPUT_DEFAULT_TABLE);
+    snprintf(setName, sizeof(setName), "%s", name);
+  }
+  else
+  {
+    snprintf(tableName, sizeof(tableName), "%.*s", (int)(space - name), name);
+    snprintf(setName, sizeof(setName), "%s", space + 1);
+    if (tableName[0] EQ 0 || tableName[0] EQ ' ' || setName[0] EQ 0)
+    {
+      fprintf(stderr, "ERR - Set name must be [family] table set for nft [%s]\n", name);
+      return (FAILED);
+    }
+  }
+
+  return (TRUE);
+}
+
+/****
+ *
+ * build the formatter tables and record text, call before any output is opened
+ *
+ ****/
+
+int initOutput(int fileCount)
+{
+  char tmpBuf[8];
+
+  seenAll = (fileCount > 1);
+
+  if (parseSetName((config->setName != NULL) ? config->setName : OUTPUT_DEFAULT_NAME) EQ FAILED)
+    return (FAILED);
+
+  for (int i = 0; i < 256; ++i)
+  {
+    octetLen[i] = (uint8_t)snprintf(tmpBuf, sizeof(tmpBuf), "%d", i);
+    memcpy(octetText[i], tmpBuf, 4);
+  }
+
+  for (int i = 0; i <= 32; ++i)
+  {
+    maskLen[i] = (uint8_t)snprintf(tmpBuf, sizeof(tmpBuf), "/%d", i);
+    memcpy(maskText[i], tmpBuf, 4);
+  }
+
+  switch (config->outputFormat)
+  {
+  case FORMAT_IPSET:
+    /* a CIDR given twice, or in two input files, would stop ipset restore */
+    snprintf(recordPrefix, sizeof(recordPrefix), "add %s ", setName);
+    snprintf(recordSuffix, sizeof(recordSuffix), " -exist\n");
+    break;
+  case FORMAT_NFT:
+    snprintf(recordPrefix, sizeof(recordPrefix), "\t");
+    snprintf(recordSuffix, sizeof(recordSuffix), ",\n");
+    chunkOpenLen = (size_t)snprintf(chunkOpen, sizeof(chunkOpen), "add element %s %s {\n", tableName, setName);
+    break;
+  case FORMAT_IPTABLES:
+    snprintf(recordPrefix, sizeof(recordPrefix), "-A %s -s ", setName);
+    snprintf(recordSuffix, sizeof(recordSuffix), " -j DROP\n");
+    break;
+  default:
+    /* plain and pf tables take one CIDR per line */
+    snprintf(recordSuffix, sizeof(recordSuffix), "\n");
+  }
+
+  return (TRUE);
+}
+
+/****
+ *
+ * open a buffered writer on fd, or an in-memory buffer when fd is below zero
+ *
+ ****/
+
+struct outputBuf_s *openOutput(int fd)
+{
+  struct outputBuf_s *out;
+#ifdef HAVE_MAPPED_OUTPUT
+  struct stat sb;
+  int flags;
+#endif
+
+  out = (struct outputBuf_s *)XMALLOC(sizeof(struct outputBuf_s));
+  out->fd = fd;
+  out->prefix = recordPrefix;
+  out->prefixLen = strlen(recordPrefix);
+  out->suffix = recordSuffix;
+  out->suffixLen = strlen(recordSuffix);
+  out->recordMax = OUTPUT_CIDR_MAX + out->prefixLen + out->suffixLen;
+  if (chunkOpenLen > 0)
+  {
+    out->chunkSize = NFT_CHUNK_SIZE;
+    out->recordMax += chunkOpenLen + sizeof(chunkClose);
+  }
+#ifdef HAVE_MAPPED_OUTPUT
+  if (fd >= 0 && fstat(fd, &sb) EQ 0 && S_ISREG(sb.st_mode) && (flags = fcntl(fd, F_GETFL)) != FAILED &&
+      (flags & O_ACCMODE) EQ O_RDWR && !(flags & O_APPEND))
+    out->mappable = TRUE;
+#endif
+  out->size = (fd >= 0) ? OUTPUT_BUFFER_SIZE : OUTPUT_BUFFER_SIZE / 16;
+  if ((out->buf = (char *)XMALLOC(out->size)) EQ NULL)
+  {
+    XFREE(out);
+    return (NULL);
+  }
+
+  return (out);
+}
+
+/****
+ *
+ * write everything buffered with as few write() calls as the fd allows
+ *
+ ****/
+
+int flushOutput(struct outputBuf_s *out)
+{
+  size_t pos = 0;
+  ssize_t wCount;
+
+  if (out->fd < 0)
+    return (TRUE);
+
+  while (pos < out->len && !out->failed)
+  {
+    if ((wCount = write(out->fd, out->buf + pos, out->len - pos)) EQ FAILED)
+    {
+      if (errno EQ EINTR)
+        continue;
+      fprintf(stderr, "ERR - Unable to write output %d (%s)\n", errno, strerror(errno));
+      out->failed = TRUE;
+    }
+    else
+      pos += (size_t)wCount;
+  }
+  out->len = 0;
+
+  return (out->failed ? FAILED : TRUE);
+}
+
+/****
+ *
+ * make room for need more bytes, flushing or growing the buffer
+ *
+ ****/
+
+PRIVATE int outputRoom(struct outputBuf_s *out, size_t need)
+{
+  char *tmpPtr;
+  size_t newSize;
+
+  if (out->fd >= 0)
+  {
+    if (flushOutput(out) EQ FAILED)
+      return (FAILED);
+    if (need <= out->size)
+      return (TRUE);
+  }
+
+  for (newSize = out->size * 2; newSize - out->len < need; newSize *= 2)
+    ;
+  if ((tmpPtr = XREALLOC(out->buf, newSize)) EQ NULL)
+    return (FAILED);
+  out->buf = tmpPtr;
+  out->size = newSize;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * append bytes as they are
+ *
+ ****/
+
+PRIVATE int appendOutput(struct outputBuf_s *out, const char *data, size_t len)
+{
+  if (out->size - out->len < len && outputRoom(out, len) EQ FAILED)
+    return (FAILED);
+
+  memcpy(out->buf + out->len, data, len);
+  out->len += len;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * close the open chunk of records, if any
+ *
+ * call before the bytes of a writer are copied into another one.
+ *
+ ****/
+
+int endOutputChunk(struct outputBuf_s *out)
+{
+  if (out->chunkCount EQ 0)
+    return (TRUE);
+  out->chunkCount = 0;
+
+  return (appendOutput(out, chunkClose, sizeof(chunkClose) - 1));
+}
+
+/****
+ *
+ * append bytes, records copied from another writer have to be whole chunks
+ *
+ ****/
+
+int writeOutput(struct outputBuf_s *out, const char *data, size_t len)
+{
+  if (endOutputChunk(out) EQ FAILED)
+    return (FAILED);
+
+  return (appendOutput(out, data, len));
+}
+
+/****
+ *
+ * append formatted text, for the rare lines that are not addresses
+ *
+ ****/
+
+int printOutput(struct outputBuf_s *out, const char *fmt, ...)
+{
+  va_list ap;
+  int count;
+
+  if (endOutputChunk(out) EQ FAILED)
+    return (FAILED);
+
+  va_start(ap, fmt);
+  count = vsnprintf(out->buf + out->len, out->size - out->len, fmt, ap);
+  va_end(ap);
+  if (count < 0)
+    return (FAILED);
+
+  if ((size_t)count >= out->size - out->len)
+  {
+    /* did not fit, make room and format it again */
+    if (outputRoom(out, (size_t)count + 1) EQ FAILED)
+      return (FAILED);
+    va_start(ap, fmt);
+    vsnprintf(out->buf + out->len, out->size - out->len, fmt, ap);
+    va_end(ap);
+  }
+  out->len += (size_t)count;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * pass an unconsolidated line through with a note, loaders only get records
+ *
+ ****/
+
+int passOutput(struct outputBuf_s *out, const char *line, size_t len, const char *note)
+{
+  if (config->outputFormat != FORMAT_PLAIN)
+    return (TRUE);
+
+  return (printOutput(out, "%.*s # %s\n", (int)len, line, note));
+}
+
+/****
+ *
+ * write what a loader needs before the first record
+ *
+ ****/
+
+int writeOutputHeader(struct outputBuf_s *out)
+{
+  uint64_t hashSize;
+
+  switch (config->outputFormat)
+  {
+  case FORMAT_IPSET:
+    /* start the hash at a quarter of the elements so it rarely has to grow */
+    for (hashSize = 1024; hashSize < config->maxElem / 4; hashSize <<= 1)
+      ;
+    return (printOutput(out, "create %s hash:net family inet hashsize %llu maxelem %llu -exist\nflush %s\n", setName,
+                        (unsigned long long)hashSize, (unsigned long long)config->maxElem, setName));
+  case FORMAT_NFT:
+    return (printOutput(out, "add table %s\nadd set %s %s { type ipv4_addr; flags interval; auto-merge; }\nflush set %s %s\n",
+                        tableName, tableName, setName, tableName, setName));
+  case FORMAT_IPTABLES:
+    return (printOutput(out, "*filter\n:%s - [0:0]\n", setName));
+  }
+
+  return (TRUE);
+}
+
+/****
+ *
+ * write what a loader needs after the last record
+ *
+ ****/
+
+int writeOutputFooter(struct outputBuf_s *out)
+{
+  if (endOutputChunk(out) EQ FAILED)
+    return (FAILED);
+
+  if (config->outputFormat EQ FORMAT_IPTABLES)
+    return (printOutput(out, "COMMIT\n"));
+
+  return (TRUE);
+}
+
+/****
+ *
+ * format network/mask at p from the octet tables in the record text of out,
+ * returns the end of the text
+ *
+ * up to 3 bytes past the end are overwritten.
+ *
+ ****/
+
+PRIVATE inline char *formatCidr(char *p, const struct outputBuf_s *out, uint32_t network, int mask)
+{
+  uint32_t octet;
+
+  if (out->prefixLen > 0)
+  {
+    memcpy(p, out->prefix, out->prefixLen);
+    p += out->prefixLen;
+  }
+  for (int shift = 24; shift > 0; shift -= 8)
+  {
+    octet = (network >> shift) & 0xff;
+    memcpy(p, octetText[octet], 4);
+    p += octetLen[octet];
+    *p++ = '.';
+  }
+  octet = network & 0xff;
+  memcpy(p, octetText[octet], 4);
+  p += octetLen[octet];
+  memcpy(p, maskText[mask], 4);
+  p += maskLen[mask];
+  if (out->suffixLen EQ 1)
+    *p++ = out->suffix[0];
+  else
+  {
+    memcpy(p, out->suffix, out->suffixLen);
+    p += out->suffixLen;
+  }
+
+  return (p);
+}
+
+/****
+ *
+ * exact length of the text formatCidr() writes
+ *
+ ****/
+
+PRIVATE inline size_t cidrTextLen(const struct outputBuf_s *out, uint32_t network, int mask)
+{
+  return (out->prefixLen + octetLen[network >> 24] + octetLen[(network >> 16) & 0xff] + octetLen[(network >> 8) & 0xff] + octetLen[network & 0xff] + 3 +
+          maskLen[mask] + out->suffixLen);
+}
+
+/****
+ *
+ * slot of key in the table of written records, empty if it is not there
+ *
+ ****/
+
+PRIVATE inline size_t seenSlot(uint64_t key)
+{
+  size_t slot = (size_t)((key * 0x9e3779b97f4a7c15ULL) >> 32) & (seenSize - 1);
+
+  while (seenKeys[slot] != 0 && seenKeys[slot] != key)
+    slot = (slot + 1) & (seenSize - 1);
+
+  return (slot);
+}
+
+/****
+ *
+ * remember a record, FALSE when it was already written
+ *
+ ****/
+
+PRIVATE int firstRecord(uint32_t network, int mask)
+{
+  uint64_t key = ((uint64_t)network << 8) | (uint64_t)(mask + 1), *oldKeys;
+  size_t oldSize, slot;
+  int ret = TRUE;
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock(&seenLock);
+#endif
+  if (seenCount >= seenSize / 2)
+  {
+    /* rehash into a table twice the size */
+    oldKeys = seenKeys;
+    oldSize = seenSize;
+    seenSize = (oldSize > 0) ? oldSize * 2 : NFT_SEEN_MIN;
+    seenKeys = (uint64_t *)XMALLOC(seenSize * sizeof(uint64_t));
+    for (size_t i = 0; i < oldSize; ++i)
+      if (oldKeys[i] != 0)
+        seenKeys[seenSlot(oldKeys[i])] = oldKeys[i];
+    if (oldKeys != NULL)
+      XFREE(oldKeys);
+  }
+
+  slot = seenSlot(key);
+  if (seenKeys[slot] EQ key)
+    ret = FALSE;
+  else
+  {
+    seenKeys[slot] = key;
+    seenCount++;
+  }
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_unlock(&seenLock);
+#endif
+
+  return (ret);
+}
+
+/****
+ *
+ * append network/mask in dotted quad form
+ *
+ * chunked (nft) records are written once, repeats are dropped.
+ *
+ ****/
+
+int writeOutputCidr(struct outputBuf_s *out, uint32_t network, int mask)
+{
+  if (out->chunkSize > 0 && (seenAll || mask < config->minBits) && !firstRecord(network, mask))
+    return (TRUE);
+
+  if (out->size - out->len < out->recordMax && outputRoom(out, out->recordMax) EQ FAILED)
+    return (FAILED);
+
+  if (out->chunkSize EQ 0)
+  {
+    out->len = formatCidr(out->buf + out->len, out, network, mask) - out->buf;
+    return (TRUE);
+  }
+
+  /* recordMax leaves room for both ends of a chunk */
+  if (out->chunkCount EQ 0)
+  {
+    memcpy(out->buf + out->len, chunkOpen, chunkOpenLen);
+    out->len += chunkOpenLen;
+  }
+  out->len = formatCidr(out->buf + out->len, out, network, mask) - out->buf;
+  if (++out->chunkCount EQ out->chunkSize)
+  {
+    memcpy(out->buf + out->len, chunkClose, sizeof(chunkClose) - 1);
+    out->len += sizeof(chunkClose) - 1;
+    out->chunkCount = 0;
+  }
+
+  return (TRUE);
+}
+
+#ifdef HAVE_MAPPED_OUTPUT
+/****
+ *
+ * size the text of one slice
+ *
+ ****/
+
+PRIVATE void *sliceLength(void *arg)
+{
+  struct outputSlice_s *slice = arg;
+  size_t len = 0;
+
+  for (size_t i = 0; i < slice->count; ++i)
+    len += cidrTextLen(slice->out, slice->list[i], slice->mask);
+  slice->len = len;
+
+  return (NULL);
+}
+
+/****
+ *
+ * format one slice into its place in the mapping
+ *
+ * the last record is copied exactly so nothing spills into the next slice.
+ *
+ ****/
+
+PRIVATE void *sliceFormat(void *arg)
+{
+  struct outputSlice_s *slice = arg;
+  char tmpBuf[OUTPUT_CIDR_MAX + 2 * OUTPUT_AFFIX_MAX];
+  char *p = slice->dst;
+
+  if (slice->count EQ 0)
+    return (NULL);
+
+  for (size_t i = 0; i < slice->count - 1; ++i)
+    p = formatCidr(p, slice->out, slice->list[i], slice->mask);
+  memcpy(p, tmpBuf, formatCidr(tmpBuf, slice->out, slice->list[slice->count - 1], slice->mask) - tmpBuf);
+
+  return (NULL);
+}
+
+/****
+ *
+ * run func on every slice, one thread each
+ *
+ ****/
+
+PRIVATE void runSlices(struct outputSlice_s *slices, int threads, void *(*func)(void *))
+{
+  pthread_t *tids;
+  int started;
+
+  tids = (pthread_t *)XMALLOC(threads * sizeof(pthread_t));
+
+  for (started = 0; started < threads; ++started)
+  {
+    if (pthread_create(&tids[started], NULL, func, &slices[started]) != 0)
+    {
+      /* finish the remaining slices on this thread */
+      for (int i = started; i < threads; ++i)
+        func(&slices[i]);
+      break;
+    }
+  }
+
+  for (int i = 0; i < started; ++i)
+    pthread_join(tids[i], NULL);
+
+  XFREE(tids);
+}
+
+/****
+ *
+ * format a run of records on several threads straight into the file
+ *
+ * every slice is sized first, the file is extended to the exact total and
+ * each thread writes its slice at its offset in a shared mapping.
+ *
+ ****/
+
+PRIVATE int writeMappedCidrs(struct outputBuf_s *out, const uint32_t *list, size_t count, int mask, int threads)
+{
+  struct outputSlice_s *slices;
+  off_t start, mapStart;
+  size_t total = 0, mapLen, per, first;
+  char *map;
+  int ret = FALSE;
+
+  if (flushOutput(out) EQ FAILED || (start = lseek(out->fd, 0, SEEK_CUR)) EQ (off_t)FAILED)
+    return (FALSE);
+
+  slices = (struct outputSlice_s *)XMALLOC(threads * sizeof(struct outputSlice_s));
+  per = (count + threads - 1) / threads;
+  for (int i = 0; i < threads; ++i)
+  {
+    first = (size_t)i * per;
+    slices[i].out = out;
+    slices[i].list = list + first;
+    slices[i].count = ((first + per < count) ? first + per : count) - first;
+    slices[i].mask = mask;
+  }
+
+  runSlices(slices, threads, sliceLength);
+  for (int i = 0; i < threads; ++i)
+    total += slices[i].len;
+
+  /* the mapping has to start on a page */
+  mapStart = start & ~((off_t)sysconf(_SC_PAGESIZE) - 1);
+  mapLen = (size_t)(start - mapStart) + total;
+
+  /* posix_fallocate() returns the error instead of setting errno */
+  if ((errno = posix_fallocate(out->fd, start, (off_t)total)) EQ 0 && ftruncate(out->fd, start + (off_t)total) EQ 0 &&
+      (map = mmap(NULL, mapLen, PROT_READ | PROT_WRITE, MAP_SHARED, out->fd, mapStart)) != MAP_FAILED)
+  {
+    slices[0].dst = map + (start - mapStart);
+    for (int i = 1; i < threads; ++i)
+      slices[i].dst = slices[i - 1].dst + slices[i - 1].len;
+
+    if (config->verbose)
+      fprintf(stderr, "Formatting [%lu] records on [%d] threads into the mapped output\n", (unsigned long)count, threads);
+    runSlices(slices, threads, sliceFormat);
+
+    /* write-back errors only show up here */
+    if (msync(map, mapLen, MS_SYNC) EQ FAILED)
+    {
+      fprintf(stderr, "ERR - Unable to write mapped output %d (%s)\n", errno, strerror(errno));
+      out->failed = TRUE;
+    }
+    munmap(map, mapLen);
+    if (lseek(out->fd, start + (off_t)total, SEEK_SET) != (off_t)FAILED)
+      ret = TRUE;
+  }
+  else if (config->verbose)
+    fprintf(stderr, "Unable to map output %d (%s), falling back to buffered writes\n", errno, strerror(errno));
+
+  if (!ret)
+  {
+    /* write() from where the run started, dropping whatever was reserved */
+    if (ftruncate(out->fd, start) EQ FAILED && config->verbose)
+      fprintf(stderr, "Unable to trim output %d (%s)\n", errno, strerror(errno));
+    lseek(out->fd, start, SEEK_SET);
+    out->mappable = FALSE;
+  }
+
+  XFREE(slices);
+
+  return (ret);
+}
+#endif
+
+/****
+ *
+ * append a run of networks that share a mask
+ *
+ ****/
+
+int writeOutputCidrs(struct outputBuf_s *out, const uint32_t *list, size_t count, int mask)
+{
+#ifdef HAVE_MAPPED_OUTPUT
+  int threads = (int)(count / OUTPUT_SLICE_MIN);
+
+  if (threads > config->threads)
+    threads = config->threads;
+  /* chunked records are counted as they are written, so they stay on this thread */
+  if (out->mappable && out->chunkSize EQ 0 && threads > 1 && writeMappedCidrs(out, list, count, mask, threads) EQ TRUE)
+    return (out->failed ? FAILED : TRUE);
+#endif
+
+  for (size_t i = 0; i < count; ++i)
+    if (writeOutputCidr(out, list[i], mask) EQ FAILED)
+      return (FAILED);
+
+  return (TRUE);
+}
+
+/****
+ *
+ * flush and release a writer, FAILED if any of its output was lost
+ *
+ ****/
+
+int closeOutput(struct outputBuf_s *out)
+{
+  int ret;
+
+  if (out EQ NULL)
+    return (TRUE);
+
+  endOutputChunk(out);
+  ret = flushOutput(out);
+  XFREE(out->buf);
+  XFREE(out);
+
+  return (ret);
+}
+
+/****
+ *
+ * release what initOutput() and the writers share
+ *
+ ****/
+
+void freeOutput(void)
+{
+  if (seenKeys != NULL)
+    XFREE(seenKeys);
+  seenKeys = NULL;
+  seenSize = seenCount = 0;
+}
@@ -0,0 +1,174 @@
+/*****
+ *
+ * Description: Buffered Output Writer Headers
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+#ifndef OUTPUT_DOT_H
+#define OUTPUT_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+#include "mem.h"
+#include <stdint.h>
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+/* the space is reserved up front, a sparse mapping faults with SIGBUS when the disk fills */
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_MMAP) && defined(HAVE_POSIX_FALLOCATE)
+#define HAVE_MAPPED_OUTPUT 1
+#endif
+
+/* bytes buffered before each write() */
+#define OUTPUT_BUFFER_SIZE (1024 * 1024)
+
+/* room needed to format "255.255.255.255/32\n", the octet copies overrun by up to 3 bytes */
+#define OUTPUT_CIDR_MAX 24
+
+/* longest text written before or after a record */
+#define OUTPUT_AFFIX_MAX 64
+
+/* longest set or chain name, ipset and iptables both stop short of 32 */
+#define OUTPUT_NAME_MAX 28
+
+/* default set or chain name, and the table nft sets go in */
+#define OUTPUT_DEFAULT_NAME "ip2cidr"
+#define OUTPUT_DEFAULT_TABLE "ip filter"
+
+/* elements per nft "add element" command, keeps each batch well under the netlink limits */
+#define NFT_CHUNK_SIZE 1024
+
+/* first size of the table of nft records already written, it doubles at half full */
+#define NFT_SEEN_MIN 4096
+
+/* ipset refuses adds past maxelem, it defaults to 65536 */
+#define IPSET_MIN_MAXELEM 65536
+#define IPSET_MAX_MAXELEM 0xffffffff
+
+/* maxelem when the input size is not known, such as stdin */
+#define IPSET_DEFAULT_MAXELEM (16 * 1024 * 1024)
+
+/* shortest input line, "1.2.3.4\n", bounds the records a file can hold */
+#define IPSET_MIN_LINE 8
+
+/* output formats */
+#define FORMAT_PLAIN 0
+#define FORMAT_IPSET 1
+#define FORMAT_NFT 2
+#define FORMAT_IPTABLES 3
+#define FORMAT_PF 4
+
+/* fewest records per thread worth formatting straight into a mapped file */
+#define OUTPUT_SLICE_MIN (256 * 1024)
+
+/****
+ *
+ * typedefs & structs
+ *
+ ****/
+
+/*
+ * user-space output buffer drained with one write() per flush.  with an fd
+ * below zero the buffer grows instead and the caller takes the bytes.
+ * mappable outputs are regular files open for read and write, large runs
+ * of records are formatted into them on several threads through mmap().
+ * every record is wrapped in the prefix and suffix of the output format,
+ * chunked formats also group records into commands of chunkSize.
+ */
+struct outputBuf_s
+{
+  int fd;
+  int failed;
+  int mappable;
+  char *buf;
+  size_t len;
+  size_t size;
+  const char *prefix;
+  size_t prefixLen;
+  const char *suffix;
+  size_t suffixLen;
+  size_t recordMax;
+  size_t chunkSize;
+  size_t chunkCount;
+};
+
+/* one thread's share of a run of records */
+struct outputSlice_s
+{
+  const struct outputBuf_s *out;
+  const uint32_t *list;
+  size_t count;
+  int mask;
+  size_t len;
+  char *dst;
+};
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+int initOutput(int fileCount);
+struct outputBuf_s *openOutput(int fd);
+int writeOutput(struct outputBuf_s *out, const char *data, size_t len);
+int printOutput(struct outputBuf_s *out, const char *fmt, ...);
+int passOutput(struct outputBuf_s *out, const char *line, size_t len, const char *note);
+int writeOutputHeader(struct outputBuf_s *out);
+int writeOutputFooter(struct outputBuf_s *out);
+int endOutputChunk(struct outputBuf_s *out);
+int writeOutputCidr(struct outputBuf_s *out, uint32_t network, int mask);
+int writeOutputCidrs(struct outputBuf_s *out, const uint32_t *list, size_t count, int mask);
+int flushOutput(struct outputBuf_s *out);
+int closeOutput(struct outputBuf_s *out);
+void freeOutput(void);
+
+#endif /* OUTPUT_DOT_H */
@@ -0,0 +1,448 @@
+/*****
+ *
+ * Description: Packed Address List
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "packlist.h"
+
+#ifdef HAVE_SIMD_PACK
+#include <immintrin.h>
+#endif
+
+/****
+ *
+ * local variables
+ *
+ ****/
+
+PRIVATE void packBlockScalar(const uint32_t *deltas, uint32_t bits, uint32_t *out);
+PRIVATE void unpackBlockScalar(const uint32_t *in, uint32_t bits, uint32_t first, uint32_t *values);
+
+/* selected by initPackCodec() */
+PRIVATE void (*packBlock)(const uint32_t *, uint32_t, uint32_t *) = packBlockScalar;
+PRIVATE void (*unpackBlock)(const uint32_t *, uint32_t, uint32_t, uint32_t *) = unpackBlockScalar;
+
+/****
+ *
+ * external variables
+ *
+ ****/
+
+extern Config_t *config;
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * block layout
+ *
+ * value i of a block is stored as its distance from value i - 4 (from the
+ * first value for i < 4) and the 128 deltas are packed at a fixed bit
+ * width.  lane i % 4 of each 128 bit word holds deltas i, i + 4, ... so a
+ * block is 4 * bits words and packs and unpacks four deltas at a time.
+ *
+ ****/
+
+PRIVATE inline uint32_t bitsMask(uint32_t bits)
+{
+  return ((bits >= 32) ? 0xffffffff : ((uint32_t)1 << bits) - 1);
+}
+
+PRIVATE void packBlockScalar(const uint32_t *deltas, uint32_t bits, uint32_t *out)
+{
+  uint32_t acc, shift, word, delta;
+
+  for (int lane = 0; lane < PACK_LANES; ++lane)
+  {
+    acc = shift = word = 0;
+    for (int k = 0; k < PACK_BLOCK / PACK_LANES; ++k)
+    {
+      delta = deltas[k * PACK_LANES + lane];
+      acc |= delta << shift;
+      if (shift + bits >= 32)
+      {
+        out[word++ * PACK_LANES + lane] = acc;
+        acc = (shift + bits > 32) ? delta >> (32 - shift) : 0;
+        shift = shift + bits - 32;
+      }
+      else
+        shift += bits;
+    }
+  }
+}
+
+PRIVATE void unpackBlockScalar(const uint32_t *in, uint32_t bits, uint32_t first, uint32_t *values)
+{
+  uint32_t mask = bitsMask(bits), shift, word, delta;
+
+  for (int lane = 0; lane < PACK_LANES; ++lane)
+  {
+    shift = word = 0;
+    for (int k = 0; k < PACK_BLOCK / PACK_LANES; ++k)
+    {
+      delta = 0;
+      if (bits > 0)
+      {
+        delta = in[word * PACK_LANES + lane] >> shift;
+        if (shift + bits > 32)
+          delta |= in[(word + 1) * PACK_LANES + lane] << (32 - shift);
+        shift += bits;
+        if (shift >= 32)
+        {
+          shift -= 32;
+          word++;
+        }
+      }
+      values[k * PACK_LANES + lane] = ((k EQ 0) ? first : values[(k - 1) * PACK_LANES + lane]) + (delta & mask);
+    }
+  }
+}
+
+#ifdef HAVE_SIMD_PACK
+__attribute__((target("sse2"))) PRIVATE void packBlockSse2(const uint32_t *deltas, uint32_t bits, uint32_t *out)
+{
+  __m128i acc = _mm_setzero_si128(), delta;
+  __m128i *dst = (__m128i *)out;
+  uint32_t shift = 0;
+
+  for (int k = 0; k < PACK_BLOCK / PACK_LANES; ++k)
+  {
+    delta = _mm_loadu_si128((const __m128i *)(deltas + k * PACK_LANES));
+    acc = _mm_or_si128(acc, _mm_sll_epi32(delta, _mm_cvtsi32_si128(shift)));
+    if (shift + bits >= 32)
+    {
+      _mm_storeu_si128(dst++, acc);
+      acc = (shift + bits > 32) ? _mm_srl_epi32(delta, _mm_cvtsi32_si128(32 - shift)) : _mm_setzero_si128();
+      shift = shift + bits - 32;
+    }
+    else
+      shift += bits;
+  }
+}
+
+/* unpack and prefix sum in one pass */
+__attribute__((target("sse2"))) PRIVATE void unpackBlockSse2(const uint32_t *in, uint32_t bits, uint32_t first, uint32_t *values)
+{
+  __m128i prev = _mm_set1_epi32((int)first), mask = _mm_set1_epi32((int)bitsMask(bits)), cur, delta;
+  const __m128i *src = (const __m128i *)in;
+  uint32_t shift = 0;
+
+  if (bits EQ 0)
+  {
+    for (int i = 0; i < PACK_BLOCK; ++i)
+      values[i] = first;
+    return;
+  }
+
+  cur = _mm_loadu_si128(src);
+  for (int k = 0; k < PACK_BLOCK / PACK_LANES; ++k)
+  {
+    delta = _mm_srl_epi32(cur, _mm_cvtsi32_si128(shift));
+    if (shift + bits > 32)
+    {
+      cur = _mm_loadu_si128(++src);
+      delta = _mm_or_si128(delta, _mm_sll_epi32(cur, _mm_cvtsi32_si128(32 - shift)));
+      shift = shift + bits - 32;
+    }
+    else if (shift + bits EQ 32)
+    {
+      shift = 0;
+      if (k < PACK_BLOCK / PACK_LANES - 1)
+        cur = _mm_loadu_si128(++src);
+    }
+    else
+      shift += bits;
+
+    prev = _mm_add_epi32(prev, _mm_and_si128(delta, mask));
+    _mm_storeu_si128((__m128i *)(values + k * PACK_LANES), prev);
+  }
+}
+#endif
+
+/****
+ *
+ * pick the codec for this cpu
+ *
+ ****/
+
+PRIVATE void initPackCodec(void)
+{
+#ifdef HAVE_SIMD_PACK
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2"))
+  {
+    packBlock = packBlockSse2;
+    unpackBlock = unpackBlockSse2;
+  }
+#endif
+}
+
+/****
+ *
+ * init an empty packed list
+ *
+ ****/
+
+void initPackedList(struct packedList_s *list)
+{
+  XMEMSET(list, 0, sizeof(struct packedList_s));
+  initPackCodec();
+}
+
+/****
+ *
+ * pack the pending values into a new block
+ *
+ ****/
+
+PRIVATE int packPending(struct packedList_s *list)
+{
+  uint32_t values[PACK_BLOCK], deltas[PACK_BLOCK], bits = 0, used = 0, n = list->pendingCount;
+  struct packBlock_s *block, *tmpBlocks;
+  uint32_t *tmpData;
+  size_t newSize;
+
+  if (n EQ 0)
+    return (TRUE);
+
+  /* a short block repeats its last value, those deltas are zero */
+  for (uint32_t i = 0; i < PACK_BLOCK; ++i)
+  {
+    values[i] = list->pending[(i < n) ? i : n - 1];
+    deltas[i] = values[i] - ((i < PACK_LANES) ? values[0] : values[i - PACK_LANES]);
+    used |= deltas[i];
+  }
+  while (bits < 32 && (used >> bits) != 0)
+    bits++;
+
+  if (list->blockCount EQ list->blockSize)
+  {
+    newSize = (list->blockSize > 0) ? list->blockSize * 2 : 1024;
+    if (newSize * sizeof(struct packBlock_s) > INT_MAX)
+    {
+      fprintf(stderr, "ERR - Packed list index is too large\n");
+      return (FAILED);
+    }
+    if ((tmpBlocks = XREALLOC(list->blocks, newSize * sizeof(struct packBlock_s))) EQ NULL)
+      return (FAILED);
+    list->blocks = tmpBlocks;
+    list->blockSize = newSize;
+  }
+
+  if (list->dataCount + bits * PACK_LANES > list->dataSize)
+  {
+    newSize = (list->dataSize > 0) ? list->dataSize * 2 : DEFAULT_PACK_WORDS;
+    if (newSize * sizeof(uint32_t) > INT_MAX)
+    {
+      fprintf(stderr, "ERR - Packed list is too large\n");
+      return (FAILED);
+    }
+    if ((tmpData = XREALLOC(list->data, newSize * sizeof(uint32_t))) EQ NULL)
+      return (FAILED);
+    list->data = tmpData;
+    list->dataSize = newSize;
+  }
+
+  block = &list->blocks[list->blockCount++];
+  block->first = values[0];
+  block->bits = bits;
+  block->count = n;
+  block->offset = list->dataCount;
+  packBlock(deltas, bits, list->data + list->dataCount);
+  list->dataCount += bits * PACK_LANES;
+  list->pendingCount = 0;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * append a value, values must be ascending
+ *
+ ****/
+
+int packAppend(struct packedList_s *list, uint32_t value)
+{
+  list->pending[list->pendingCount++] = value;
+  list->count++;
+
+  if (list->pendingCount EQ PACK_BLOCK)
+    return (packPending(list));
+
+  return (TRUE);
+}
+
+/****
+ *
+ * pack the last partial block and trim the data
+ *
+ ****/
+
+int finishPackedList(struct packedList_s *list)
+{
+  uint32_t *tmpData;
+
+  if (packPending(list) EQ FAILED)
+    return (FAILED);
+
+  /* release the unused tail of the packed data */
+  if (list->dataCount > 0 && list->dataCount < list->dataSize)
+  {
+    if ((tmpData = XREALLOC(list->data, list->dataCount * sizeof(uint32_t))) != NULL)
+    {
+      list->data = tmpData;
+      list->dataSize = list->dataCount;
+    }
+  }
+
+  return (TRUE);
+}
+
+/****
+ *
+ * bytes held by the packed data and the skip index
+ *
+ ****/
+
+size_t packedListBytes(const struct packedList_s *list)
+{
+  return (list->dataSize * sizeof(uint32_t) + list->blockSize * sizeof(struct packBlock_s));
+}
+
+/****
+ *
+ * free a packed list
+ *
+ ****/
+
+void freePackedList(struct packedList_s *list)
+{
+  if (list->data != NULL)
+    XFREE(list->data);
+  if (list->blocks != NULL)
+    XFREE(list->blocks);
+
+  XMEMSET(list, 0, sizeof(struct packedList_s));
+}
+
+/****
+ *
+ * decode one block into the cursor
+ *
+ ****/
+
+PRIVATE void loadBlock(struct packCursor_s *cursor, size_t block)
+{
+  const struct packBlock_s *entry = &cursor->list->blocks[block];
+
+  unpackBlock(cursor->list->data + entry->offset, entry->bits, entry->first, cursor->values);
+  cursor->block = block;
+  cursor->count = entry->count;
+  cursor->pos = 0;
+}
+
+/****
+ *
+ * start reading a finished packed list from the beginning
+ *
+ ****/
+
+void initPackCursor(struct packCursor_s *cursor, const struct packedList_s *list)
+{
+  cursor->list = list;
+  cursor->block = 0;
+  cursor->pos = cursor->count = 0;
+
+  if (list->blockCount > 0)
+    loadBlock(cursor, 0);
+}
+
+/****
+ *
+ * next value, FALSE at the end of the list
+ *
+ ****/
+
+int packNext(struct packCursor_s *cursor, uint32_t *value)
+{
+  if (cursor->pos EQ cursor->count)
+  {
+    if (cursor->block + 1 >= cursor->list->blockCount)
+      return (FALSE);
+    loadBlock(cursor, cursor->block + 1);
+  }
+
+  *value = cursor->values[cursor->pos++];
+
+  return (TRUE);
+}
+
+/****
+ *
+ * move forward so the next value is the first one not below value
+ *
+ * the skip index finds the block, blocks in between are not decoded.
+ *
+ ****/
+
+void packSeek(struct packCursor_s *cursor, uint32_t value)
+{
+  const struct packedList_s *list = cursor->list;
+  size_t lo = cursor->block + 1, hi = list->blockCount, mid;
+
+  /* last block that starts at or below value */
+  while (lo < hi)
+  {
+    mid = lo + (hi - lo) / 2;
+    if (list->blocks[mid].first <= value)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (lo - 1 > cursor->block)
+    loadBlock(cursor, lo - 1);
+
+  while (cursor->pos < cursor->count && cursor->values[cursor->pos] < value)
+    cursor->pos++;
+}
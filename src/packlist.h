@@ -0,0 +1,137 @@
+/*****
+ *
+ * Description: Packed Address List Headers
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+#ifndef PACKLIST_DOT_H
+#define PACKLIST_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+#include "mem.h"
+#include <limits.h>
+#include <stdint.h>
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+#if defined(HAVE_IMMINTRIN_H) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_SIMD_PACK 1
+#endif
+
+/* addresses per packed block */
+#define PACK_BLOCK 128
+
+/* deltas are taken four lanes apart so a block decodes with vector adds */
+#define PACK_LANES 4
+
+/* initial size of the packed data in 32 bit words */
+#define DEFAULT_PACK_WORDS 4096
+
+/****
+ *
+ * typedefs & structs
+ *
+ ****/
+
+/* skip index entry, one per block */
+struct packBlock_s
+{
+  uint32_t first;
+  uint32_t bits;
+  uint32_t count;
+  size_t offset;
+};
+
+/*
+ * sorted, unique addresses kept as blocks of bit-packed deltas.  values
+ * are appended in ascending order and the last partial block is packed by
+ * finishPackedList().
+ */
+struct packedList_s
+{
+  uint32_t *data;
+  size_t dataCount;
+  size_t dataSize;
+  struct packBlock_s *blocks;
+  size_t blockCount;
+  size_t blockSize;
+  uint64_t count;
+  uint32_t pending[PACK_BLOCK];
+  uint32_t pendingCount;
+};
+
+/* decodes one block at a time */
+struct packCursor_s
+{
+  const struct packedList_s *list;
+  size_t block;
+  uint32_t pos;
+  uint32_t count;
+  uint32_t values[PACK_BLOCK];
+};
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+void initPackedList(struct packedList_s *list);
+int packAppend(struct packedList_s *list, uint32_t value);
+int finishPackedList(struct packedList_s *list);
+size_t packedListBytes(const struct packedList_s *list);
+void freePackedList(struct packedList_s *list);
+void initPackCursor(struct packCursor_s *cursor, const struct packedList_s *list);
+int packNext(struct packCursor_s *cursor, uint32_t *value);
+void packSeek(struct packCursor_s *cursor, uint32_t value);
+
+#endif /* PACKLIST_DOT_H */
@@ -0,0 +1,324 @@
+/*****
+ *
+ * Description: Address Parser Functions
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "parse.h"
+
+#ifdef HAVE_SSE_PARSER
+#include <smmintrin.h>
+#endif
+
+/****
+ *
+ * local variables
+ *
+ ****/
+
+PRIVATE int parseDottedQuadScalar(const char *str, size_t len, uint32_t *addr);
+PRIVATE int parseLooseCidr(const char *line, size_t len, uint32_t *addr, int *mask);
+PRIVATE int (*parseDottedQuad)(const char *str, size_t len, uint32_t *addr) = parseDottedQuadScalar;
+
+#ifdef HAVE_SSE_PARSER
+/* shuffle controls indexed by octet lengths, one [0,h,t,u] dword per octet */
+PRIVATE uint8_t quadShuffle[81][16];
+#endif
+
+/****
+ *
+ * external variables
+ *
+ ****/
+
+extern Config_t *config;
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * parse dotted quad one character at a time
+ *
+ ****/
+
+PRIVATE int parseDottedQuadScalar(const char *str, size_t len, uint32_t *addr)
+{
+  uint32_t result = 0, octet;
+  size_t pos = 0, digits;
+
+  for (int i = 0; i < 4; ++i)
+  {
+    if (i > 0)
+    {
+      if (pos >= len || str[pos] != '.')
+        return (FALSE);
+      pos++;
+    }
+
+    for (octet = 0, digits = 0; pos < len && digits < 3 && str[pos] >= '0' && str[pos] <= '9'; ++pos, ++digits)
+      octet = (octet * 10) + (str[pos] - '0');
+
+    /* same rules as inet_pton(), no empty octets and no leading zeros */
+    if (digits EQ 0 || octet > 255 || (digits > 1 && str[pos - digits] EQ '0'))
+      return (FALSE);
+
+    result = (result << 8) | octet;
+  }
+
+  if (pos != len)
+    return (FALSE);
+
+  *addr = result;
+  return (TRUE);
+}
+
+#ifdef HAVE_SSE_PARSER
+
+/****
+ *
+ * build shuffle controls for every octet length combination
+ *
+ ****/
+
+PRIVATE void buildQuadShuffle(void)
+{
+  int len[4], pos;
+
+  for (int i = 0; i < 81; ++i)
+  {
+    len[0] = (i / 27) + 1;
+    len[1] = ((i / 9) % 3) + 1;
+    len[2] = ((i / 3) % 3) + 1;
+    len[3] = (i % 3) + 1;
+
+    for (int octet = 0, start = 0; octet < 4; start += len[octet++] + 1)
+    {
+      quadShuffle[i][octet * 4] = 0x80;
+      for (int k = 0; k < 3; ++k)
+      {
+        pos = start + len[octet] - 3 + k;
+        quadShuffle[i][(octet * 4) + 1 + k] = (pos < start) ? 0x80 : pos;
+      }
+    }
+  }
+}
+
+/****
+ *
+ * parse dotted quad with SSE4.1
+ *
+ * classify digits and dots in one 16 byte load, shuffle each octet into
+ * its own [0,h,t,u] dword and multiply-add the digits into octet values
+ *
+ ****/
+
+__attribute__((target("sse4.1"))) PRIVATE int parseDottedQuadSse(const char *str, size_t len, uint32_t *addr)
+{
+  __m128i input, digits, values;
+  uint32_t lenMask, dotMask, digitMask, d0, d1, d2, l0, l1, l2, l3;
+
+  /* the 16 byte load must not cross into the next page */
+  if (len < 7 || len > MAX_IPV4_STR_LEN || ((uintptr_t)str & 4095) > 4096 - 16)
+    return (parseDottedQuadScalar(str, len, addr));
+
+  input = _mm_loadu_si128((const __m128i *)str);
+  digits = _mm_sub_epi8(input, _mm_set1_epi8('0'));
+
+  lenMask = (1U << len) - 1;
+  dotMask = _mm_movemask_epi8(_mm_cmpeq_epi8(input, _mm_set1_epi8('.'))) & lenMask;
+  digitMask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits)) & lenMask;
+
+  if ((dotMask | digitMask) != lenMask || __builtin_popcount(dotMask) != 3)
+    return (FALSE);
+
+  d0 = __builtin_ctz(dotMask);
+  dotMask &= dotMask - 1;
+  d1 = __builtin_ctz(dotMask);
+  dotMask &= dotMask - 1;
+  d2 = __builtin_ctz(dotMask);
+
+  l0 = d0;
+  l1 = d1 - d0 - 1;
+  l2 = d2 - d1 - 1;
+  l3 = len - d2 - 1;
+
+  /* every octet must be 1 to 3 digits */
+  if (l0 - 1 > 2 || l1 - 1 > 2 || l2 - 1 > 2 || l3 - 1 > 2)
+    return (FALSE);
+
+  if ((l0 > 1 && str[0] EQ '0') || (l1 > 1 && str[d0 + 1] EQ '0') ||
+      (l2 > 1 && str[d1 + 1] EQ '0') || (l3 > 1 && str[d2 + 1] EQ '0'))
+    return (FALSE);
+
+  values = _mm_shuffle_epi8(digits, _mm_loadu_si128((const __m128i *)quadShuffle[((l0 - 1) * 27) + ((l1 - 1) * 9) + ((l2 - 1) * 3) + (l3 - 1)]));
+  values = _mm_madd_epi16(_mm_maddubs_epi16(values, _mm_set1_epi32(0x010a6400)), _mm_set1_epi16(1));
+
+  if (_mm_movemask_epi8(_mm_cmpgt_epi32(values, _mm_set1_epi32(255))))
+    return (FALSE);
+
+  values = _mm_packus_epi32(values, values);
+  values = _mm_packus_epi16(values, values);
+  *addr = ntohl((uint32_t)_mm_cvtsi128_si32(values));
+
+  return (TRUE);
+}
+#endif
+
+/****
+ *
+ * select the fastest dotted quad parser for this cpu
+ *
+ ****/
+
+void initParser(void)
+{
+#ifdef HAVE_SSE_PARSER
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.1"))
+  {
+    buildQuadShuffle();
+    parseDottedQuad = parseDottedQuadSse;
+
+    if (config->verbose)
+      fprintf(stderr, "Using SSE4.1 address parser\n");
+  }
+#endif
+}
+
+/****
+ *
+ * parse a CIDR the way sscanf("%d.%d.%d.%d/%d") did
+ *
+ * blanks before each number, zero padded numbers and any text after the
+ * mask are allowed, so lists that older releases read still load
+ *
+ ****/
+
+PRIVATE int parseLooseCidr(const char *line, size_t len, uint32_t *addr, int *mask)
+{
+  static const char seps[] = ".../";
+  size_t pos = 0, digits;
+  uint32_t value, quad = 0;
+
+  for (int field = 0; field < 5; ++field)
+  {
+    while (pos < len && isspace((unsigned char)line[pos]))
+      pos++;
+
+    for (value = 0, digits = 0; pos < len && line[pos] >= '0' && line[pos] <= '9'; ++pos, ++digits)
+    {
+      value = (value * 10) + (line[pos] - '0');
+      if (value > 255)
+        return (FALSE);
+    }
+
+    if (digits EQ 0)
+      return (FALSE);
+
+    if (field EQ 4)
+    {
+      if (value < 1 || value > 32)
+        return (FALSE);
+      *addr = quad;
+      *mask = (int)value;
+      return (TRUE);
+    }
+
+    if (pos >= len || line[pos] != seps[field])
+      return (FALSE);
+    pos++;
+    quad = (quad << 8) | value;
+  }
+
+  return (FALSE);
+}
+
+/****
+ *
+ * classify a line as IPv4, IPv4 CIDR, IPv6 candidate or unknown
+ *
+ ****/
+
+int parseAddress(const char *line, size_t len, uint32_t *addr, int *mask)
+{
+  const char *slash;
+  size_t addrLen = len;
+  int maskBits = 0;
+
+  /* shortest is "0.0.0.0", longest is "255.255.255.255/32" */
+  if (len >= 7 && len <= MAX_IPV4_STR_LEN + 3)
+  {
+    if ((slash = memchr(line, '/', len)) != NULL)
+      addrLen = slash - line;
+
+    if (addrLen <= MAX_IPV4_STR_LEN && parseDottedQuad(line, addrLen, addr))
+    {
+      if (addrLen EQ len)
+        return (ADDR_TYPE_IPV4);
+
+      /* netmask, 1 or 2 digits without a leading zero */
+      for (size_t pos = addrLen + 1; pos < len && maskBits >= 0; ++pos)
+      {
+        if (line[pos] < '0' || line[pos] > '9' || pos - addrLen > 2)
+          maskBits = -1;
+        else
+          maskBits = (maskBits * 10) + (line[pos] - '0');
+      }
+
+      if (len - addrLen > 1 && line[addrLen + 1] != '0' && maskBits >= 0 && maskBits <= 32)
+      {
+        *mask = maskBits;
+        return (ADDR_TYPE_IPV4_CIDR);
+      }
+    }
+  }
+
+  /* anything else with a netmask gets the slower, more forgiving parse */
+  if (memchr(line, '/', len) != NULL && parseLooseCidr(line, len, addr, mask))
+    return (ADDR_TYPE_IPV4_CIDR);
+
+  /* only lines with a ':' are worth handing to inet_pton() */
+  if (memchr(line, ':', len) != NULL)
+    return (ADDR_TYPE_IPV6);
+
+  return (ADDR_TYPE_UNKNOWN);
+}
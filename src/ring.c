@@ -0,0 +1,237 @@
+/*****
+ *
+ * Description: Single Producer Single Consumer Ring
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "ring.h"
+
+#ifdef HAVE_SCHED_H
+#include <sched.h>
+#endif
+
+/****
+ *
+ * external variables
+ *
+ ****/
+
+extern Config_t *config;
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * let the other side of the ring run
+ *
+ ****/
+
+PRIVATE inline void ringWait(void)
+{
+#ifdef HAVE_SCHED_H
+  sched_yield();
+#endif
+}
+
+/****
+ *
+ * wake the other side if it went to sleep on the ring
+ *
+ * the index or closed flag is stored before sleeping is read, and the
+ * sleeper sets sleeping before it reads them, so one of the two always
+ * sees the other.
+ *
+ ****/
+
+PRIVATE inline void ringWake(struct spscRing_s *ring)
+{
+#ifdef HAVE_PTHREAD_H
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&ring->sleeping, __ATOMIC_RELAXED))
+  {
+    pthread_mutex_lock(&ring->lock);
+    pthread_cond_signal(&ring->moved);
+    pthread_mutex_unlock(&ring->lock);
+  }
+#endif
+}
+
+/****
+ *
+ * sleep until the ring has room (full) or an item (empty) or is closed
+ *
+ ****/
+
+PRIVATE void ringSleep(struct spscRing_s *ring, int full)
+{
+#ifdef HAVE_PTHREAD_H
+  size_t head, tail;
+
+  pthread_mutex_lock(&ring->lock);
+  __atomic_store_n(&ring->sleeping, TRUE, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  for (;;)
+  {
+    head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (full ? (tail - head <= ring->mask) : (tail != head || __atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE)))
+      break;
+    pthread_cond_wait(&ring->moved, &ring->lock);
+  }
+  __atomic_store_n(&ring->sleeping, FALSE, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&ring->lock);
+#else
+  ringWait();
+#endif
+}
+
+/****
+ *
+ * init an empty ring with room for at least minSize items
+ *
+ ****/
+
+int initRing(struct spscRing_s *ring, size_t minSize)
+{
+  size_t size = 1;
+
+  while (size < minSize)
+    size <<= 1;
+
+  XMEMSET(ring, 0, sizeof(struct spscRing_s));
+  if ((ring->slots = (void **)XMALLOC(size * sizeof(void *))) EQ NULL)
+    return (FAILED);
+  ring->mask = size - 1;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_init(&ring->lock, NULL);
+  pthread_cond_init(&ring->moved, NULL);
+#endif
+
+  return (TRUE);
+}
+
+/****
+ *
+ * add an item, waits while the ring is full
+ *
+ * only the producer calls this.
+ *
+ ****/
+
+void ringPush(struct spscRing_s *ring, void *item)
+{
+  size_t tail = ring->tail;
+
+  for (int spin = 0; tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) > ring->mask; ++spin)
+  {
+    if (spin < RING_SPIN_COUNT)
+      ringWait();
+    else
+      ringSleep(ring, TRUE);
+  }
+
+  ring->slots[tail & ring->mask] = item;
+  __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+  ringWake(ring);
+}
+
+/****
+ *
+ * take the oldest item, waits while the ring is empty
+ *
+ * only the consumer calls this.  returns FALSE once the ring is closed and
+ * drained.
+ *
+ ****/
+
+int ringPop(struct spscRing_s *ring, void **item)
+{
+  size_t head = ring->head;
+
+  for (int spin = 0; __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) EQ head; ++spin)
+  {
+    /* the producer closes after its last push, so check the tail again */
+    if (__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE) && __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) EQ head)
+      return (FALSE);
+    if (spin < RING_SPIN_COUNT)
+      ringWait();
+    else
+      ringSleep(ring, FALSE);
+  }
+
+  *item = ring->slots[head & ring->mask];
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+  ringWake(ring);
+
+  return (TRUE);
+}
+
+/****
+ *
+ * no more items will be pushed
+ *
+ ****/
+
+void ringClose(struct spscRing_s *ring)
+{
+  __atomic_store_n(&ring->closed, TRUE, __ATOMIC_RELEASE);
+  ringWake(ring);
+}
+
+/****
+ *
+ * free a ring, the items belong to the caller
+ *
+ ****/
+
+void freeRing(struct spscRing_s *ring)
+{
+  if (ring->slots != NULL)
+  {
+    XFREE(ring->slots);
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_destroy(&ring->lock);
+    pthread_cond_destroy(&ring->moved);
+#endif
+  }
+  XMEMSET(ring, 0, sizeof(struct spscRing_s));
+}
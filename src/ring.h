@@ -0,0 +1,109 @@
+/*****
+ *
+ * Description: Single Producer Single Consumer Ring Headers
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+#ifndef RING_DOT_H
+#define RING_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+#include "mem.h"
+#include <stdint.h>
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+/* times a side yields before it sleeps until the other side moves */
+#define RING_SPIN_COUNT 64
+
+/****
+ *
+ * typedefs & structs
+ *
+ ****/
+
+/*
+ * bounded queue of pointers between exactly one producer thread and one
+ * consumer thread.  each side only writes its own index, so no locks are
+ * needed.  the indexes are kept on separate cache lines.  a side that has
+ * waited RING_SPIN_COUNT yields sleeps on the condition, the ring can not be
+ * full and empty at once so only one side ever sleeps.
+ */
+struct spscRing_s
+{
+  void **slots;
+  size_t mask;
+  char pad0[64];
+  size_t head;
+  char pad1[64];
+  size_t tail;
+  int closed;
+  int sleeping;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_t lock;
+  pthread_cond_t moved;
+#endif
+};
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+int initRing(struct spscRing_s *ring, size_t minSize);
+void ringPush(struct spscRing_s *ring, void *item);
+int ringPop(struct spscRing_s *ring, void **item);
+void ringClose(struct spscRing_s *ring);
+void freeRing(struct spscRing_s *ring);
+
+#endif /* RING_DOT_H */
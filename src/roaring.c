@@ -0,0 +1,726 @@
+/*****
+ *
+ * Description: Roaring style address containers
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "roaring.h"
+
+/****
+ *
+ * external variables
+ *
+ ****/
+
+extern Config_t *config;
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * bit helpers
+ *
+ ****/
+
+PRIVATE inline int ctz64(uint64_t x)
+{
+#ifdef __GNUC__
+  return (__builtin_ctzll(x));
+#else
+  int n = 0;
+
+  while (!(x & 1))
+  {
+    x >>= 1;
+    n++;
+  }
+  return (n);
+#endif
+}
+
+/* next bit at or after from that is set (or clear), 65536 when none */
+PRIVATE uint32_t nextBit(const uint64_t *words, uint32_t from, int set)
+{
+  uint64_t word;
+
+  while (from < 65536)
+  {
+    word = (set) ? words[from >> 6] : ~words[from >> 6];
+    word &= ~(uint64_t)0 << (from & 63);
+    if (word)
+      return ((from & ~(uint32_t)63) + ctz64(word));
+    from = (from | 63) + 1;
+  }
+
+  return (65536);
+}
+
+/* first array value that is not below key */
+PRIVATE uint32_t lowerBound(const uint16_t *values, uint32_t count, uint32_t key)
+{
+  uint32_t lo = 0, hi = count, mid;
+
+  while (lo < hi)
+  {
+    mid = lo + (hi - lo) / 2;
+    if (values[mid] < key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return (lo);
+}
+
+/* first run that ends at or after key */
+PRIVATE uint32_t runBound(const struct roaringRun_s *runs, uint32_t count, uint32_t key)
+{
+  uint32_t lo = 0, hi = count, mid;
+
+  while (lo < hi)
+  {
+    mid = lo + (hi - lo) / 2;
+    if (runs[mid].last < key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return (lo);
+}
+
+PRIVATE int compareValues(const void *a, const void *b)
+{
+  return ((int)*(const uint16_t *)a - (int)*(const uint16_t *)b);
+}
+
+/****
+ *
+ * init an empty container set
+ *
+ ****/
+
+int initRoaring(struct roaring_s *roaring)
+{
+  XMEMSET(roaring, 0, sizeof(struct roaring_s));
+  initPopcount();
+
+  if ((roaring->containers = (struct roaringContainer_s **)XMALLOC(ROARING_CONTAINERS * sizeof(struct roaringContainer_s *))) EQ NULL)
+  {
+    fprintf(stderr, "ERR - Unable to allocate memory for container directory\n");
+    return (FAILED);
+  }
+
+  return (TRUE);
+}
+
+/****
+ *
+ * container for a /16, created empty on first use
+ *
+ ****/
+
+PRIVATE struct roaringContainer_s *getContainer(struct roaring_s *roaring, uint32_t key)
+{
+  struct roaringContainer_s *container;
+
+  if ((container = roaring->containers[key]) != NULL)
+    return (container);
+
+  if ((container = (struct roaringContainer_s *)XMALLOC(sizeof(struct roaringContainer_s))) EQ NULL)
+  {
+    fprintf(stderr, "ERR - Unable to allocate memory for container\n");
+    return (NULL);
+  }
+  container->type = CONTAINER_ARRAY;
+  roaring->containers[key] = container;
+  roaring->containerCount++;
+
+  return (container);
+}
+
+/****
+ *
+ * sort and dedupe an array container
+ *
+ ****/
+
+PRIVATE void compactArray(struct roaringContainer_s *container)
+{
+  uint32_t count = 0;
+
+  qsort(container->data.values, container->count, sizeof(uint16_t), compareValues);
+  for (uint32_t i = 0; i < container->count; ++i)
+    if (count EQ 0 || container->data.values[i] != container->data.values[count - 1])
+      container->data.values[count++] = container->data.values[i];
+
+  container->count = container->cardinality = count;
+}
+
+/****
+ *
+ * convert an array or run container to a bitmap
+ *
+ ****/
+
+PRIVATE int toBitmap(struct roaringContainer_s *container)
+{
+  uint64_t *words;
+  uint32_t low;
+
+  if (container->type EQ CONTAINER_BITMAP)
+    return (TRUE);
+
+  if ((words = (uint64_t *)XMALLOC(ROARING_BITMAP_WORDS * sizeof(uint64_t))) EQ NULL)
+  {
+    fprintf(stderr, "ERR - Unable to allocate memory for bitmap container\n");
+    return (FAILED);
+  }
+
+  for (uint32_t i = 0; i < container->count; ++i)
+  {
+    if (container->type EQ CONTAINER_ARRAY)
+    {
+      low = container->data.values[i];
+      words[low >> 6] |= (uint64_t)1 << (low & 63);
+    }
+    else
+      for (low = container->data.runs[i].start; low <= container->data.runs[i].last; ++low)
+        words[low >> 6] |= (uint64_t)1 << (low & 63);
+  }
+
+  if (container->count > 0 || container->size > 0)
+    XFREE(container->data.values);
+  container->data.words = words;
+  container->type = CONTAINER_BITMAP;
+  container->count = container->size = 0;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * add one address, adds must come before roaringOptimize()
+ *
+ ****/
+
+int roaringAdd(struct roaring_s *roaring, uint32_t addr)
+{
+  struct roaringContainer_s *container;
+  uint16_t *tmpPtr;
+  uint32_t low = addr & 0xffff, newSize;
+
+  if ((container = getContainer(roaring, addr >> 16)) EQ NULL)
+    return (FAILED);
+
+  if (container->type EQ CONTAINER_ARRAY && container->count EQ container->size && container->size >= ROARING_BUILD_MAX)
+  {
+    compactArray(container);
+    if (container->count > ROARING_ARRAY_MAX && toBitmap(container) EQ FAILED)
+      return (FAILED);
+  }
+
+  if (container->type != CONTAINER_ARRAY && toBitmap(container) EQ FAILED)
+    return (FAILED);
+
+  if (container->type EQ CONTAINER_BITMAP)
+  {
+    container->data.words[low >> 6] |= (uint64_t)1 << (low & 63);
+    return (TRUE);
+  }
+
+  if (container->count EQ container->size)
+  {
+    newSize = (container->size > 0) ? container->size * 2 : 16;
+    if ((tmpPtr = XREALLOC(container->data.values, newSize * sizeof(uint16_t))) EQ NULL)
+      return (FAILED);
+    container->data.values = tmpPtr;
+    container->size = newSize;
+  }
+  container->data.values[container->count++] = low;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * add every address from start to end, one /16 at a time
+ *
+ ****/
+
+int roaringAddRange(struct roaring_s *roaring, uint32_t start, uint32_t end)
+{
+  struct roaringContainer_s *container;
+  uint32_t chunkEnd, first, last;
+  uint64_t *words;
+
+  for (;;)
+  {
+    chunkEnd = ((start | 0xffff) < end) ? (start | 0xffff) : end;
+    if ((container = getContainer(roaring, start >> 16)) EQ NULL || toBitmap(container) EQ FAILED)
+      return (FAILED);
+
+    words = container->data.words;
+    first = (start & 0xffff) >> 6;
+    last = (chunkEnd & 0xffff) >> 6;
+    if (first EQ last)
+      words[first] |= (~(uint64_t)0 << (start & 63)) & (~(uint64_t)0 >> (63 - (chunkEnd & 63)));
+    else
+    {
+      words[first] |= ~(uint64_t)0 << (start & 63);
+      if (last > first + 1)
+        memset(words + first + 1, 0xff, (last - first - 1) * sizeof(uint64_t));
+      words[last] |= ~(uint64_t)0 >> (63 - (chunkEnd & 63));
+    }
+
+    if (chunkEnd EQ end)
+      return (TRUE);
+    start = chunkEnd + 1;
+  }
+}
+
+/****
+ *
+ * rebuild a container as the smallest of array, bitmap or run list
+ *
+ ****/
+
+PRIVATE int optimizeContainer(struct roaringContainer_s *container)
+{
+  struct roaringRun_s *runs = NULL;
+  uint64_t *words, prev = 0;
+  uint16_t *values = NULL;
+  uint32_t runCount = 0, arrayBytes, runBytes, count = 0, low;
+  uint32_t type;
+
+  if (container->type EQ CONTAINER_ARRAY)
+  {
+    compactArray(container);
+    for (uint32_t i = 0; i < container->count; ++i)
+      if (i EQ 0 || container->data.values[i] != container->data.values[i - 1] + 1)
+        runCount++;
+  }
+  else if (container->type EQ CONTAINER_BITMAP)
+  {
+    words = container->data.words;
+    container->cardinality = (uint32_t)bitmapPopcount(words, ROARING_BITMAP_WORDS);
+    for (uint32_t i = 0; i < ROARING_BITMAP_WORDS; ++i)
+    {
+      /* a run starts at every set bit whose lower neighbour is clear */
+      runCount += (uint32_t)bitmapPopcount((uint64_t[]){words[i] & ~((words[i] << 1) | (prev >> 63))}, 1);
+      prev = words[i];
+    }
+  }
+  else
+    return (TRUE);
+
+  arrayBytes = (container->cardinality <= ROARING_ARRAY_MAX) ? container->cardinality * sizeof(uint16_t) : UINT32_MAX;
+  runBytes = runCount * sizeof(struct roaringRun_s);
+
+  if (runBytes < arrayBytes && runBytes < ROARING_BITMAP_WORDS * sizeof(uint64_t))
+    type = CONTAINER_RUN;
+  else if (arrayBytes <= ROARING_BITMAP_WORDS * sizeof(uint64_t))
+    type = CONTAINER_ARRAY;
+  else
+    type = CONTAINER_BITMAP;
+
+  if (type EQ container->type)
+    return (TRUE);
+
+  if (type EQ CONTAINER_RUN)
+  {
+    if ((runs = (struct roaringRun_s *)XMALLOC(runCount * sizeof(struct roaringRun_s))) EQ NULL)
+      return (FAILED);
+
+    if (container->type EQ CONTAINER_ARRAY)
+    {
+      for (uint32_t i = 0; i < container->count; ++i)
+      {
+        if (count > 0 && container->data.values[i] EQ runs[count - 1].last + 1)
+          runs[count - 1].last = container->data.values[i];
+        else
+        {
+          runs[count].start = runs[count].last = container->data.values[i];
+          count++;
+        }
+      }
+    }
+    else
+    {
+      for (low = nextBit(container->data.words, 0, TRUE); low < 65536; low = nextBit(container->data.words, low, TRUE))
+      {
+        runs[count].start = (uint16_t)low;
+        low = nextBit(container->data.words, low, FALSE);
+        runs[count++].last = (uint16_t)(low - 1);
+      }
+    }
+
+    if (container->data.values != NULL)
+      XFREE(container->data.values);
+    container->data.runs = runs;
+    container->count = container->size = runCount;
+  }
+  else if (type EQ CONTAINER_ARRAY)
+  {
+    /* only a bitmap can get here */
+    if (container->cardinality > 0 && (values = (uint16_t *)XMALLOC(container->cardinality * sizeof(uint16_t))) EQ NULL)
+      return (FAILED);
+
+    for (low = nextBit(container->data.words, 0, TRUE); low < 65536; low = nextBit(container->data.words, low + 1, TRUE))
+      values[count++] = (uint16_t)low;
+
+    XFREE(container->data.words);
+    container->data.values = values;
+    container->count = container->size = count;
+  }
+  else if (toBitmap(container) EQ FAILED)
+    return (FAILED);
+
+  container->type = type;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * pick the smallest representation for every container
+ *
+ ****/
+
+int roaringOptimize(struct roaring_s *roaring)
+{
+  for (uint32_t key = 0; key < ROARING_CONTAINERS; ++key)
+    if (roaring->containers[key] != NULL && optimizeContainer(roaring->containers[key]) EQ FAILED)
+    {
+      fprintf(stderr, "ERR - Unable to allocate memory for container\n");
+      return (FAILED);
+    }
+
+  return (TRUE);
+}
+
+/****
+ *
+ * bytes held by containers, counts[type] gets the containers of each type
+ *
+ ****/
+
+uint64_t roaringSize(struct roaring_s *roaring, uint32_t counts[])
+{
+  struct roaringContainer_s *container;
+  uint64_t bytes = ROARING_CONTAINERS * sizeof(struct roaringContainer_s *);
+
+  for (int type = 0; type <= CONTAINER_RUN; ++type)
+    counts[type] = 0;
+
+  for (uint32_t key = 0; key < ROARING_CONTAINERS; ++key)
+  {
+    if ((container = roaring->containers[key]) EQ NULL)
+      continue;
+
+    counts[container->type]++;
+    bytes += sizeof(struct roaringContainer_s);
+    if (container->type EQ CONTAINER_BITMAP)
+      bytes += ROARING_BITMAP_WORDS * sizeof(uint64_t);
+    else if (container->type EQ CONTAINER_ARRAY)
+      bytes += container->size * sizeof(uint16_t);
+    else
+      bytes += container->size * sizeof(struct roaringRun_s);
+  }
+
+  return (bytes);
+}
+
+/****
+ *
+ * number of values from lo to hi in one container
+ *
+ ****/
+
+PRIVATE uint64_t containerCount(struct roaringContainer_s *container, uint32_t lo, uint32_t hi)
+{
+  const uint64_t *words;
+  uint32_t first, last, i;
+  uint64_t count = 0;
+
+  if (lo EQ 0 && hi EQ 0xffff)
+    return (container->cardinality);
+
+  if (container->type EQ CONTAINER_ARRAY)
+    return (lowerBound(container->data.values, container->count, hi + 1) - lowerBound(container->data.values, container->count, lo));
+
+  if (container->type EQ CONTAINER_RUN)
+  {
+    for (i = runBound(container->data.runs, container->count, lo); i < container->count && container->data.runs[i].start <= hi; ++i)
+      count += (uint64_t)((container->data.runs[i].last < hi) ? container->data.runs[i].last : hi) -
+               ((container->data.runs[i].start > lo) ? container->data.runs[i].start : lo) + 1;
+    return (count);
+  }
+
+  words = container->data.words;
+  first = lo >> 6;
+  last = hi >> 6;
+  if (first EQ last)
+    return (bitmapPopcount((uint64_t[]){words[first] & (~(uint64_t)0 << (lo & 63)) & (~(uint64_t)0 >> (63 - (hi & 63)))}, 1));
+
+  count = bitmapPopcount((uint64_t[]){words[first] & (~(uint64_t)0 << (lo & 63))}, 1);
+  count += bitmapPopcount(words + first + 1, last - first - 1);
+  count += bitmapPopcount((uint64_t[]){words[last] & (~(uint64_t)0 >> (63 - (hi & 63)))}, 1);
+
+  return (count);
+}
+
+/****
+ *
+ * number of addresses in the start/len block
+ *
+ ****/
+
+uint64_t roaringCount(struct roaring_s *roaring, uint32_t start, int len)
+{
+  struct roaringContainer_s *container;
+  uint64_t count = 0;
+
+  if (len <= 16)
+  {
+    for (uint64_t key = start >> 16; key < (start >> 16) + ((uint64_t)1 << (16 - len)); ++key)
+      if (roaring->containers[key] != NULL)
+        count += roaring->containers[key]->cardinality;
+    return (count);
+  }
+
+  if ((container = roaring->containers[start >> 16]) EQ NULL)
+    return (0);
+
+  return (containerCount(container, start & 0xffff, (start & 0xffff) + (((uint32_t)1 << (32 - len)) - 1)));
+}
+
+/****
+ *
+ * add the values from lo to hi in one container to the leftovers
+ *
+ ****/
+
+PRIVATE int containerLeftovers(struct roaringContainer_s *container, uint32_t base, uint32_t lo, uint32_t hi, struct addrVector_s *hosts, struct rangeVector_s *ranges)
+{
+  uint64_t word;
+  uint32_t i;
+
+  if (container->type EQ CONTAINER_RUN)
+  {
+    for (i = runBound(container->data.runs, container->count, lo); i < container->count && container->data.runs[i].start <= hi; ++i)
+      if (addRangeVector(ranges, base | ((container->data.runs[i].start > lo) ? container->data.runs[i].start : lo),
+                         base | ((container->data.runs[i].last < hi) ? container->data.runs[i].last : hi)) EQ FAILED)
+        return (FAILED);
+    return (TRUE);
+  }
+
+  if (container->type EQ CONTAINER_ARRAY)
+  {
+    for (i = lowerBound(container->data.values, container->count, lo); i < container->count && container->data.values[i] <= hi; ++i)
+    {
+      if (hosts->count EQ hosts->size && growAddrVector(hosts, hosts->count + 1) EQ FAILED)
+        return (FAILED);
+      hosts->list[hosts->count++] = base | container->data.values[i];
+    }
+    return (TRUE);
+  }
+
+  for (i = lo >> 6; i <= (hi >> 6); ++i)
+  {
+    word = container->data.words[i];
+    if (i EQ (lo >> 6))
+      word &= ~(uint64_t)0 << (lo & 63);
+    if (i EQ (hi >> 6))
+      word &= ~(uint64_t)0 >> (63 - (hi & 63));
+
+    if (word EQ ~(uint64_t)0)
+    {
+      if (addRangeVector(ranges, base | (i << 6), base | ((i << 6) + 63)) EQ FAILED)
+        return (FAILED);
+      continue;
+    }
+
+    for (; word; word &= word - 1)
+    {
+      if (hosts->count EQ hosts->size && growAddrVector(hosts, hosts->count + 1) EQ FAILED)
+        return (FAILED);
+      hosts->list[hosts->count++] = base | ((i << 6) + ctz64(word));
+    }
+  }
+
+  return (TRUE);
+}
+
+/****
+ *
+ * add the addresses in the start/len block to the leftovers
+ *
+ ****/
+
+PRIVATE int roaringLeftovers(struct roaring_s *roaring, uint32_t start, int len, struct addrVector_s *hosts, struct rangeVector_s *ranges)
+{
+  if (len <= 16)
+  {
+    for (uint64_t key = start >> 16; key < (start >> 16) + ((uint64_t)1 << (16 - len)); ++key)
+      if (roaring->containers[key] != NULL && containerLeftovers(roaring->containers[key], (uint32_t)(key << 16), 0, 0xffff, hosts, ranges) EQ FAILED)
+        return (FAILED);
+    return (TRUE);
+  }
+
+  if (roaring->containers[start >> 16] EQ NULL)
+    return (TRUE);
+
+  return (containerLeftovers(roaring->containers[start >> 16], start & 0xffff0000, start & 0xffff, (start & 0xffff) + (((uint32_t)1 << (32 - len)) - 1), hosts, ranges));
+}
+
+/****
+ *
+ * consolidate one block whose count is already known
+ *
+ ****/
+
+PRIVATE int consolidateRoaringBlock(struct roaring_s *roaring, uint32_t start, int len, uint64_t count, const uint64_t minCount[], int maxBits, struct cidrVector_s *cidrs, struct addrVector_s *hosts, struct rangeVector_s *ranges)
+{
+  uint64_t left;
+
+  if (count EQ 0)
+    return (TRUE);
+
+  if (len > maxBits)
+    return (roaringLeftovers(roaring, start, len, hosts, ranges));
+
+  if (count >= minCount[len])
+    return (addCidrVector(cidrs, start, len));
+
+  if (len EQ maxBits)
+    return (roaringLeftovers(roaring, start, len, hosts, ranges));
+
+  if (count EQ ((uint64_t)1 << (32 - len)))
+  {
+    /* every block inside a full block is full */
+    for (int subLen = len + 1; subLen <= maxBits; ++subLen)
+      if (((uint64_t)1 << (32 - subLen)) >= minCount[subLen])
+      {
+        for (uint64_t b = 0; b < ((uint64_t)1 << (subLen - len)); ++b)
+          if (addCidrVector(cidrs, start + (uint32_t)(b << (32 - subLen)), subLen) EQ FAILED)
+            return (FAILED);
+        return (TRUE);
+      }
+
+    return (addRangeVector(ranges, start, start + (uint32_t)(count - 1)));
+  }
+
+  left = roaringCount(roaring, start, len + 1);
+  if (consolidateRoaringBlock(roaring, start, len + 1, left, minCount, maxBits, cidrs, hosts, ranges) EQ FAILED)
+    return (FAILED);
+
+  return (consolidateRoaringBlock(roaring, start | (0x80000000 >> len), len + 1, count - left, minCount, maxBits, cidrs, hosts, ranges));
+}
+
+/****
+ *
+ * consolidate the containers one /minBits block at a time
+ *
+ * kept blocks go to cidrs in address order, addresses that are not in a
+ * kept block go to hosts and ranges.  only /16s with a container are
+ * visited.
+ *
+ ****/
+
+int consolidateRoaring(struct roaring_s *roaring, const uint64_t minCount[], int minBits, int maxBits, struct cidrVector_s *cidrs, struct addrVector_s *hosts, struct rangeVector_s *ranges)
+{
+  uint64_t keysPerBlock, blocksPerKey;
+  uint32_t start;
+
+  if (minBits <= 16)
+  {
+    keysPerBlock = (uint64_t)1 << (16 - minBits);
+    for (uint64_t key = 0; key < ROARING_CONTAINERS; key += keysPerBlock)
+    {
+      start = (uint32_t)(key << 16);
+      if (consolidateRoaringBlock(roaring, start, minBits, roaringCount(roaring, start, minBits), minCount, maxBits, cidrs, hosts, ranges) EQ FAILED)
+        return (FAILED);
+    }
+    return (TRUE);
+  }
+
+  blocksPerKey = (uint64_t)1 << (minBits - 16);
+  for (uint32_t key = 0; key < ROARING_CONTAINERS; ++key)
+  {
+    if (roaring->containers[key] EQ NULL)
+      continue;
+
+    for (uint64_t b = 0; b < blocksPerKey; ++b)
+    {
+      start = (key << 16) | (uint32_t)(b << (32 - minBits));
+      if (consolidateRoaringBlock(roaring, start, minBits, roaringCount(roaring, start, minBits), minCount, maxBits, cidrs, hosts, ranges) EQ FAILED)
+        return (FAILED);
+    }
+  }
+
+  return (TRUE);
+}
+
+/****
+ *
+ * free all containers
+ *
+ ****/
+
+void freeRoaring(struct roaring_s *roaring)
+{
+  if (roaring->containers != NULL)
+  {
+    for (uint32_t key = 0; key < ROARING_CONTAINERS; ++key)
+    {
+      if (roaring->containers[key] EQ NULL)
+        continue;
+      if (roaring->containers[key]->data.values != NULL)
+        XFREE(roaring->containers[key]->data.values);
+      XFREE(roaring->containers[key]);
+    }
+    XFREE(roaring->containers);
+  }
+
+  XMEMSET(roaring, 0, sizeof(struct roaring_s));
+}
@@ -0,0 +1,134 @@
+/*****
+ *
+ * Description: Roaring style address containers
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+#ifndef ROARING_DOT_H
+#define ROARING_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+#include "mem.h"
+#include "vector.h"
+#include "bitmap.h"
+#include <stdint.h>
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+#define ROARING_CONTAINERS 65536
+
+/* above this many values an array is larger than a bitmap */
+#define ROARING_ARRAY_MAX 4096
+
+/* unsorted values an array collects before it is compacted */
+#define ROARING_BUILD_MAX 8192
+
+#define ROARING_BITMAP_WORDS 1024
+
+#define CONTAINER_ARRAY 1
+#define CONTAINER_BITMAP 2
+#define CONTAINER_RUN 3
+
+/****
+ *
+ * typedefs & structs
+ *
+ ****/
+
+/* inclusive run of addresses inside one /16 */
+struct roaringRun_s
+{
+  uint16_t start;
+  uint16_t last;
+};
+
+/*
+ * the low 16 bits of every address in one /16.  arrays and bitmaps are
+ * used while adding, roaringOptimize() then keeps whichever of array,
+ * bitmap or run list is smallest.
+ */
+struct roaringContainer_s
+{
+  union
+  {
+    uint16_t *values;
+    uint64_t *words;
+    struct roaringRun_s *runs;
+  } data;
+  uint32_t type;
+  uint32_t count;
+  uint32_t size;
+  uint32_t cardinality;
+};
+
+struct roaring_s
+{
+  struct roaringContainer_s **containers;
+  uint32_t containerCount;
+};
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+int initRoaring(struct roaring_s *roaring);
+int roaringAdd(struct roaring_s *roaring, uint32_t addr);
+int roaringAddRange(struct roaring_s *roaring, uint32_t start, uint32_t end);
+int roaringOptimize(struct roaring_s *roaring);
+uint64_t roaringCount(struct roaring_s *roaring, uint32_t start, int len);
+uint64_t roaringSize(struct roaring_s *roaring, uint32_t counts[]);
+int consolidateRoaring(struct roaring_s *roaring, const uint64_t minCount[], int minBits, int maxBits, struct cidrVector_s *cidrs, struct addrVector_s *hosts, struct rangeVector_s *ranges);
+void freeRoaring(struct roaring_s *roaring);
+
+#endif /* ROARING_DOT_H */
@@ -35,12 +35,23 @@
 #include "sort.h"
 #include "mem.h"
 
+#ifdef HAVE_AVX2_SORT
+#include <immintrin.h>
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
 /****
  *
  * local variables
  *
  ****/
 
+PRIVATE void mergeSortedScalar32(const uint32_t *a, size_t aCount, const uint32_t *b, size_t bCount, uint32_t *dst);
+PRIVATE void heapSort32(uint32_t array[], size_t count);
+PRIVATE void introSort32(uint32_t array[], uint32_t low, uint32_t high, int depth);
+PRIVATE void (*smallSortKernel)(uint32_t array[], size_t count) = insertionSort32;
+PRIVATE void (*mergeKernel)(const uint32_t *a, size_t aCount, const uint32_t *b, size_t bCount, uint32_t *dst) = mergeSortedScalar32;
+
 /****
  *
  * external global variables
@@ -57,12 +68,28 @@ extern Config_t *config;
 
 
 /****
- * 
+ *
+ * compare ranges by start address
+ *
+ ****/
+
+PRIVATE int compareRanges(const void *a, const void *b)
+{
+  const struct ipv4Range_s *ra = a, *rb = b;
+
+  if (ra->start < rb->start)
+    return (-1);
+  return (ra->start > rb->start);
+}
+
+/****
+ *
  * swap 32 bit integers
- * 
+ *
  ****/
 
-void swap32(uint32_t *a, uint32_t *b) {
+void swap32(uint32_t *a, uint32_t *b)
+{
   uint32_t t = *a;
   *a = *b;
   *b = t;
@@ -73,37 +100,1021 @@ void swap32(uint32_t *a, uint32_t *b) {
  *
  * quick sort partition - 32 bit
  *
+ * the median of the first, middle and last keys is moved to high and used
+ * as the pivot so sorted and reverse sorted partitions split in half
+ *
  ****/
 
-uint32_t quickSortPartition32( uint32_t array[], uint32_t low, uint32_t high)
+uint32_t quickSortPartition32(uint32_t array[], uint32_t low, uint32_t high)
 {
-  uint32_t pivot = array[high];
+  uint32_t mid = low + (high - low) / 2;
+  uint32_t pivot;
   uint32_t i = (low - 1);
 
-  for (uint32_t j = low; j < high; j++) {
-    if (array[j] <= pivot) {
+  if (array[mid] < array[low])
+    swap32(&array[mid], &array[low]);
+  if (array[high] < array[low])
+    swap32(&array[high], &array[low]);
+  if (array[mid] < array[high])
+    swap32(&array[mid], &array[high]);
+  pivot = array[high];
+
+  for (uint32_t j = low; j < high; j++)
+  {
+    if (array[j] <= pivot)
+    {
       i++;
-      
       swap32(&array[i], &array[j]);
     }
   }
 
   swap32(&array[i + 1], &array[high]);
-  
+
   return (i + 1);
 }
 
 /****
  *
- * quick sort partition - 32 bit
+ * heap sort - 32 bit, bounds the quick sort worst case
+ *
+ ****/
+
+PRIVATE void heapSiftDown32(uint32_t array[], size_t root, size_t count)
+{
+  size_t child;
+
+  while ((child = 2 * root + 1) < count)
+  {
+    if (child + 1 < count && array[child] < array[child + 1])
+      child++;
+    if (array[root] >= array[child])
+      return;
+    swap32(&array[root], &array[child]);
+    root = child;
+  }
+}
+
+PRIVATE void heapSort32(uint32_t array[], size_t count)
+{
+  for (size_t i = count / 2; i-- > 0;)
+    heapSiftDown32(array, i, count);
+
+  for (size_t end = count; end-- > 1;)
+  {
+    swap32(&array[0], &array[end]);
+    heapSiftDown32(array, 0, end);
+  }
+}
+
+/****
+ *
+ * intro sort - 32 bit
+ *
+ * quick sort that recurses into the smaller side and loops on the larger,
+ * partitions that are still splitting badly after depth levels (runs of
+ * duplicates or crafted input) are finished with a heap sort
+ *
+ ****/
+
+PRIVATE void introSort32(uint32_t array[], uint32_t low, uint32_t high, int depth)
+{
+  uint32_t pi;
+
+  while (low < high)
+  {
+    if (high - low < SORT_NETWORK_MAX)
+    {
+      smallSort32(array + low, high - low + 1);
+      return;
+    }
+
+    if (depth-- EQ 0)
+    {
+      heapSort32(array + low, (size_t)high - low + 1);
+      return;
+    }
+
+    pi = quickSortPartition32(array, low, high);
+    if (pi - low < high - pi)
+    {
+      if (pi > low)
+        introSort32(array, low, pi - 1, depth);
+      low = pi + 1;
+    }
+    else
+    {
+      if (pi < high)
+        introSort32(array, pi + 1, high, depth);
+      if (pi EQ low)
+        return;
+      high = pi - 1;
+    }
+  }
+}
+
+/****
+ *
+ * quick sort - 32 bit
+ *
+ ****/
+
+void quickSort32(uint32_t array[], uint32_t low, uint32_t high)
+{
+  int depth = 0;
+
+  if (low >= high)
+    return;
+
+  /* allow twice the depth of an even split before giving up on it */
+  for (size_t n = (size_t)high - low + 1; n > 1; n >>= 1)
+    depth += 2;
+
+  introSort32(array, low, high, depth);
+}
+
+/****
+ *
+ * insertion sort - 32 bit
+ *
+ ****/
+
+void insertionSort32(uint32_t array[], size_t count)
+{
+  uint32_t key;
+  size_t j;
+
+  for (size_t i = 1; i < count; ++i)
+  {
+    key = array[i];
+    for (j = i; j > 0 && array[j - 1] > key; --j)
+      array[j] = array[j - 1];
+    array[j] = key;
+  }
+}
+
+/****
+ *
+ * scalar merge of two sorted lists
+ *
+ ****/
+
+PRIVATE void mergeSortedScalar32(const uint32_t *a, size_t aCount, const uint32_t *b, size_t bCount, uint32_t *dst)
+{
+  size_t ia = 0, ib = 0, d = 0;
+
+  while (ia < aCount && ib < bCount)
+    dst[d++] = (b[ib] < a[ia]) ? b[ib++] : a[ia++];
+  while (ia < aCount)
+    dst[d++] = a[ia++];
+  while (ib < bCount)
+    dst[d++] = b[ib++];
+}
+
+#ifdef HAVE_AVX2_SORT
+/****
+ *
+ * avx2 sorting networks
+ *
+ * 64 keys are held as 8 registers of 8 lanes.  the columns are sorted with
+ * an 8 input network, the 8x8 block is transposed so every register holds
+ * a sorted row, then the rows are bitonic merged into 16, 32 and 64 key
+ * sequences.  keys are unsigned so min/max_epu32 are the comparators.
+ *
+ ****/
+
+AVX2_TARGET PRIVATE inline void compareSwap8(__m256i *a, __m256i *b)
+{
+  __m256i tmp = _mm256_min_epu32(*a, *b);
+
+  *b = _mm256_max_epu32(*a, *b);
+  *a = tmp;
+}
+
+AVX2_TARGET PRIVATE inline __m256i reverse8(__m256i v)
+{
+  return (_mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0)));
+}
+
+/* sort a bitonic register with half cleaners at lane distance 4, 2 and 1 */
+AVX2_TARGET PRIVATE inline __m256i bitonicClean8(__m256i v)
+{
+  __m256i p;
+
+  p = _mm256_permute2x128_si256(v, v, 0x01);
+  v = _mm256_blend_epi32(_mm256_min_epu32(v, p), _mm256_max_epu32(v, p), 0xf0);
+  p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+  v = _mm256_blend_epi32(_mm256_min_epu32(v, p), _mm256_max_epu32(v, p), 0xcc);
+  p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+  v = _mm256_blend_epi32(_mm256_min_epu32(v, p), _mm256_max_epu32(v, p), 0xaa);
+
+  return (v);
+}
+
+/* merge two sorted sequences of regCount registers each into one */
+AVX2_TARGET PRIVATE inline void bitonicMerge8(__m256i *r, int regCount)
+{
+  __m256i tmp;
+
+  /* reversing the second half makes the whole sequence bitonic */
+  for (int i = 0; i < regCount / 2; ++i)
+  {
+    tmp = reverse8(r[regCount + i]);
+    r[regCount + i] = reverse8(r[2 * regCount - 1 - i]);
+    r[2 * regCount - 1 - i] = tmp;
+  }
+  if (regCount & 1)
+    r[regCount] = reverse8(r[regCount]);
+
+  for (int dist = regCount; dist > 0; dist /= 2)
+    for (int i = 0; i < 2 * regCount; ++i)
+      if (!(i & dist))
+        compareSwap8(&r[i], &r[i + dist]);
+
+  for (int i = 0; i < 2 * regCount; ++i)
+    r[i] = bitonicClean8(r[i]);
+}
+
+AVX2_TARGET PRIVATE void sortNetworkAvx2(uint32_t array[], size_t count)
+{
+  uint32_t buf[SORT_NETWORK_MAX];
+  __m256i r[8], t[8];
+
+  if (count <= SORT_NETWORK_MIN)
+  {
+    insertionSort32(array, count);
+    return;
+  }
+
+  /* pad the block with keys that sort to the end */
+  memcpy(buf, array, count * sizeof(uint32_t));
+  for (size_t i = count; i < SORT_NETWORK_MAX; ++i)
+    buf[i] = 0xffffffff;
+  for (int i = 0; i < 8; ++i)
+    r[i] = _mm256_loadu_si256((const __m256i *)(buf + i * 8));
+
+  /* 19 comparator network sorts each lane across the registers */
+  compareSwap8(&r[0], &r[2]);
+  compareSwap8(&r[1], &r[3]);
+  compareSwap8(&r[4], &r[6]);
+  compareSwap8(&r[5], &r[7]);
+  compareSwap8(&r[0], &r[4]);
+  compareSwap8(&r[1], &r[5]);
+  compareSwap8(&r[2], &r[6]);
+  compareSwap8(&r[3], &r[7]);
+  compareSwap8(&r[0], &r[1]);
+  compareSwap8(&r[2], &r[3]);
+  compareSwap8(&r[4], &r[5]);
+  compareSwap8(&r[6], &r[7]);
+  compareSwap8(&r[2], &r[4]);
+  compareSwap8(&r[3], &r[5]);
+  compareSwap8(&r[1], &r[4]);
+  compareSwap8(&r[3], &r[6]);
+  compareSwap8(&r[1], &r[2]);
+  compareSwap8(&r[3], &r[4]);
+  compareSwap8(&r[5], &r[6]);
+
+  /* transpose so each register is a sorted row */
+  for (int i = 0; i < 8; i += 2)
+  {
+    t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+    t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+  }
+  for (int i = 0; i < 8; i += 4)
+  {
+    r[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+    r[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+    r[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+    r[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+  }
+  for (int i = 0; i < 4; ++i)
+  {
+    t[i] = _mm256_permute2x128_si256(r[i], r[i + 4], 0x20);
+    t[i + 4] = _mm256_permute2x128_si256(r[i], r[i + 4], 0x31);
+  }
+
+  /* merge rows into 16, 32 and 64 key runs */
+  for (int regCount = 1; regCount < 8; regCount *= 2)
+    for (int i = 0; i < 8; i += 2 * regCount)
+      bitonicMerge8(t + i, regCount);
+
+  for (int i = 0; i < 8; ++i)
+    _mm256_storeu_si256((__m256i *)(buf + i * 8), t[i]);
+  memcpy(array, buf, count * sizeof(uint32_t));
+}
+
+/****
+ *
+ * avx2 merge of two sorted lists
+ *
+ * the smallest 8 of the held register and the next block are written out
+ * each step, the next block comes from the list with the smaller head.
+ * once a list is down to a partial block the rest is merged in scalar.
+ *
+ ****/
+
+AVX2_TARGET PRIVATE void mergeSortedAvx2(const uint32_t *a, size_t aCount, const uint32_t *b, size_t bCount, uint32_t *dst)
+{
+  uint32_t held[8];
+  __m256i r[2];
+  size_t ia = 8, ib = 8, h = 0, d = 8;
+
+  if (aCount < 8 || bCount < 8)
+  {
+    mergeSortedScalar32(a, aCount, b, bCount, dst);
+    return;
+  }
+
+  r[0] = _mm256_loadu_si256((const __m256i *)a);
+  r[1] = _mm256_loadu_si256((const __m256i *)b);
+  bitonicMerge8(r, 1);
+  _mm256_storeu_si256((__m256i *)dst, r[0]);
+
+  while ((ia + 8 <= aCount || ia EQ aCount) && (ib + 8 <= bCount || ib EQ bCount) && (ia < aCount || ib < bCount))
+  {
+    if (ib EQ bCount || (ia < aCount && a[ia] <= b[ib]))
+    {
+      r[0] = _mm256_loadu_si256((const __m256i *)(a + ia));
+      ia += 8;
+    }
+    else
+    {
+      r[0] = _mm256_loadu_si256((const __m256i *)(b + ib));
+      ib += 8;
+    }
+    bitonicMerge8(r, 1);
+    _mm256_storeu_si256((__m256i *)(dst + d), r[0]);
+    d += 8;
+  }
+
+  /* three way merge of the held keys and both tails */
+  _mm256_storeu_si256((__m256i *)held, r[1]);
+  while (h < 8 || ia < aCount || ib < bCount)
+  {
+    if (h < 8 && (ia EQ aCount || held[h] <= a[ia]) && (ib EQ bCount || held[h] <= b[ib]))
+      dst[d++] = held[h++];
+    else if (ia < aCount && (ib EQ bCount || a[ia] <= b[ib]))
+      dst[d++] = a[ia++];
+    else
+      dst[d++] = b[ib++];
+  }
+}
+#endif
+
+/****
+ *
+ * sort a small partition of up to SORT_NETWORK_MAX keys
+ *
+ ****/
+
+void smallSort32(uint32_t array[], size_t count)
+{
+  if (count > SORT_NETWORK_MAX)
+    quickSort32(array, 0, count - 1);
+  else
+    (*smallSortKernel)(array, count);
+}
+
+/****
+ *
+ * merge two sorted lists into dst, dst may not overlap either list
+ *
+ ****/
+
+void mergeSorted32(const uint32_t *a, size_t aCount, const uint32_t *b, size_t bCount, uint32_t *dst)
+{
+  (*mergeKernel)(a, aCount, b, bCount, dst);
+}
+
+/****
+ *
+ * select the fastest sort kernels for this cpu
+ *
+ ****/
+
+void initSort(void)
+{
+#ifdef HAVE_AVX2_SORT
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    smallSortKernel = sortNetworkAvx2;
+    mergeKernel = mergeSortedAvx2;
+
+    if (config->verbose)
+      fprintf(stderr, "Using AVX2 sorting networks\n");
+  }
+#endif
+}
+
+/****
+ *
+ * add keys to the histograms of every lsd radix pass
+ *
+ * hist holds RADIX_PASSES * RADIX_BUCKETS counters.  callers that see the
+ * keys before the sort can build it as they go.
+ *
+ ****/
+
+void radixHistogram32(const uint32_t array[], size_t count, size_t *hist)
+{
+  uint32_t key;
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    key = array[i];
+    hist[key & RADIX_MASK]++;
+    hist[RADIX_BUCKETS + ((key >> RADIX_BITS) & RADIX_MASK)]++;
+    hist[(2 * RADIX_BUCKETS) + (key >> (2 * RADIX_BITS))]++;
+  }
+}
+
+/****
+ *
+ * lsd radix sort - 32 bit
+ *
+ * histograms for every pass are built in a single read of the keys, then
+ * each pass scatters between the list and a scratch buffer.  passes where
+ * every key has the same digit are skipped.
+ *
+ * there is no software prefetch, the histogram read is sequential and the
+ * hardware prefetcher keeps up, and prefetching the scatter slots a few
+ * keys ahead measured no faster on 10M-50M key lists.
+ *
+ ****/
+
+void radixSort32(uint32_t array[], size_t count)
+{
+  size_t *hist;
+
+  if (count < RADIX_MIN_COUNT)
+  {
+    insertionSort32(array, count);
+    return;
+  }
+
+  hist = (size_t *)XMALLOC(RADIX_PASSES * RADIX_BUCKETS * sizeof(size_t));
+  radixHistogram32(array, count, hist);
+  radixSort32Counted(array, count, hist);
+  XFREE(hist);
+}
+
+/****
+ *
+ * lsd radix sort - 32 bit, with the histograms already built
+ *
+ * the histograms are used up by the sort.
+ *
+ ****/
+
+void radixSort32Counted(uint32_t array[], size_t count, size_t *hist)
+{
+  size_t *offsets, sum, tmpCount;
+  uint32_t *scratch, *src = array, *dst, *tmpPtr, key;
+  int shift;
+
+  if (count < RADIX_MIN_COUNT)
+  {
+    insertionSort32(array, count);
+    return;
+  }
+
+  scratch = dst = (uint32_t *)XMALLOC(count * sizeof(uint32_t));
+
+  for (int pass = 0; pass < RADIX_PASSES; ++pass)
+  {
+    offsets = hist + (pass * RADIX_BUCKETS);
+    shift = pass * RADIX_BITS;
+
+    /* every key lands in the same bucket, nothing to move */
+    if (offsets[(src[0] >> shift) & RADIX_MASK] EQ count)
+      continue;
+
+    sum = 0;
+    for (int b = 0; b < RADIX_BUCKETS; ++b)
+    {
+      tmpCount = offsets[b];
+      offsets[b] = sum;
+      sum += tmpCount;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      key = src[i];
+      dst[offsets[(key >> shift) & RADIX_MASK]++] = key;
+    }
+
+    tmpPtr = src;
+    src = dst;
+    dst = tmpPtr;
+  }
+
+  if (src != array)
+    memcpy(array, src, count * sizeof(uint32_t));
+
+  XFREE(scratch);
+}
+
+/****
+ *
+ * radix sort the low 24 bits of one top byte bucket from src into dst
+ *
+ ****/
+
+PRIVATE void radixSortBucket(uint32_t *src, uint32_t *dst, size_t count)
+{
+  size_t hist[PSORT_LOW_PASSES][256], sum, tmpCount;
+  uint32_t *in = src, *out = dst, *tmpPtr, key;
+  int shift;
+
+  if (count < RADIX_MIN_COUNT)
+  {
+    insertionSort32(src, count);
+    memcpy(dst, src, count * sizeof(uint32_t));
+    return;
+  }
+
+  memset(hist, 0, sizeof(hist));
+  for (size_t i = 0; i < count; ++i)
+  {
+    key = src[i];
+    hist[0][key & 0xff]++;
+    hist[1][(key >> 8) & 0xff]++;
+    hist[2][(key >> 16) & 0xff]++;
+  }
+
+  for (int pass = 0; pass < PSORT_LOW_PASSES; ++pass)
+  {
+    shift = pass * 8;
+
+    if (hist[pass][(in[0] >> shift) & 0xff] EQ count)
+      continue;
+
+    sum = 0;
+    for (int b = 0; b < 256; ++b)
+    {
+      tmpCount = hist[pass][b];
+      hist[pass][b] = sum;
+      sum += tmpCount;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      key = in[i];
+      out[hist[pass][(key >> shift) & 0xff]++] = key;
+    }
+
+    tmpPtr = in;
+    in = out;
+    out = tmpPtr;
+  }
+
+  if (in != dst)
+    memcpy(dst, in, count * sizeof(uint32_t));
+}
+
+#ifdef HAVE_PTHREAD_H
+
+/****
+ *
+ * parallel sort worker, count one byte of the keys in a slice
+ *
+ ****/
+
+PRIVATE void *sortHistogramWorker(void *arg)
+{
+  struct sortWorker_s *worker = arg;
+
+  for (size_t i = worker->start; i < worker->end; ++i)
+    worker->hist[(worker->src[i] >> worker->shift) & 0xff]++;
+
+  return (NULL);
+}
+
+/****
+ *
+ * parallel sort worker, scatter a slice into its buckets on one byte
+ *
+ ****/
+
+PRIVATE void *sortScatterWorker(void *arg)
+{
+  struct sortWorker_s *worker = arg;
+  uint32_t key;
+
+  for (size_t i = worker->start; i < worker->end; ++i)
+  {
+    key = worker->src[i];
+    worker->dst[worker->hist[(key >> worker->shift) & 0xff]++] = key;
+  }
+
+  return (NULL);
+}
+
+/****
+ *
+ * parallel sort worker, copy a split bucket slice back to the scratch list
+ *
+ ****/
+
+PRIVATE void *sortCopyWorker(void *arg)
+{
+  struct sortWorker_s *worker = arg;
+
+  memcpy(worker->src + worker->start, worker->dst + worker->start, (worker->end - worker->start) * sizeof(uint32_t));
+
+  return (NULL);
+}
+
+/****
+ *
+ * parallel sort worker, sort a run of buckets back into the list
+ *
+ ****/
+
+PRIVATE void *sortBucketWorker(void *arg)
+{
+  struct sortWorker_s *worker = arg;
+  size_t start, end;
+
+  for (size_t b = worker->firstBucket; b < worker->lastBucket; ++b)
+  {
+    start = worker->bucketStart[b];
+    end = worker->bucketStart[b + 1];
+    if (end > start)
+      radixSortBucket(worker->src + start, worker->dst + start, end - start);
+  }
+
+  return (NULL);
+}
+
+/****
+ *
+ * run one phase of the parallel sort on every worker
  *
  ****/
 
-void quickSort32( uint32_t array[], uint32_t low, uint32_t high)
+PRIVATE void runSortWorkers(struct sortWorker_s *workers, int threads, void *(*func)(void *))
 {
-  if (low < high) {
-    uint32_t pi = quickSortPartition32(array, low, high);
-    quickSort32(array, low, pi - 1);
-    quickSort32(array, pi + 1, high);
+  pthread_t *tids;
+  int started;
+
+  tids = (pthread_t *)XMALLOC(threads * sizeof(pthread_t));
+
+  for (started = 0; started < threads; ++started)
+  {
+    if (pthread_create(&tids[started], NULL, func, &workers[started]) != 0)
+    {
+      /* finish the remaining work on this thread */
+      for (int i = started; i < threads; ++i)
+        func(&workers[i]);
+      break;
+    }
   }
+
+  for (int i = 0; i < started; ++i)
+    pthread_join(tids[i], NULL);
+
+  XFREE(tids);
+}
+
+/****
+ *
+ * count and scatter keys start to end of src into dst on one byte
+ *
+ * the slice is shared out between the threads and the 256 bucket starts
+ * are written to bucketStart, the last one is end
+ *
+ ****/
+
+PRIVATE void parallelScatter32(struct sortWorker_s *workers, int threads, uint32_t *src, uint32_t *dst, size_t start, size_t end, int shift, size_t *bucketStart)
+{
+  size_t count = end - start, sum, tmpCount;
+  int b, t;
+
+  for (t = 0; t < threads; ++t)
+  {
+    workers[t].src = src;
+    workers[t].dst = dst;
+    workers[t].shift = shift;
+    workers[t].start = start + (count / threads) * t;
+    workers[t].end = (t EQ threads - 1) ? end : start + (count / threads) * (t + 1);
+    memset(workers[t].hist, 0, sizeof(workers[t].hist));
+  }
+
+  runSortWorkers(workers, threads, sortHistogramWorker);
+
+  /* bucket b of thread t starts after bucket b of every earlier thread */
+  sum = start;
+  for (b = 0; b < PSORT_BUCKETS; ++b)
+  {
+    bucketStart[b] = sum;
+    for (t = 0; t < threads; ++t)
+    {
+      tmpCount = workers[t].hist[b];
+      workers[t].hist[b] = sum;
+      sum += tmpCount;
+    }
+  }
+  bucketStart[PSORT_BUCKETS] = end;
+
+  runSortWorkers(workers, threads, sortScatterWorker);
+}
+#endif
+
+/****
+ *
+ * parallel msd radix sort - 32 bit
+ *
+ * threads count and scatter slices of the list into 256 buckets on the
+ * top byte.  a bucket holding more than count / threads keys is split the
+ * same way on the next byte, and again on the one after, so skewed lists
+ * still spread across the threads.  each thread then lsd sorts a
+ * contiguous run of buckets with roughly the same number of keys.  the
+ * result is the same as any other sort of the list.
+ *
+ ****/
+
+void parallelRadixSort32(uint32_t array[], size_t count, int threads)
+{
+#ifdef HAVE_PTHREAD_H
+  struct sortWorker_s *workers;
+  size_t *bucketStart, *splitStart, *tmpStart, bucketCount, splitCount, maxBuckets, target, b;
+  uint32_t *scratch;
+  int t;
+
+  if (threads < 2 || count < PARALLEL_SORT_MIN_COUNT)
+  {
+    radixSort32(array, count);
+    return;
+  }
+
+  /* fewer than threads buckets can be over count / threads on each level */
+  maxBuckets = PSORT_BUCKETS + (size_t)threads * (PSORT_BUCKETS - 1) * PSORT_SPLIT_LEVELS + 1;
+  workers = (struct sortWorker_s *)XMALLOC(threads * sizeof(struct sortWorker_s));
+  scratch = (uint32_t *)XMALLOC(count * sizeof(uint32_t));
+  bucketStart = (size_t *)XMALLOC(maxBuckets * sizeof(size_t));
+  splitStart = (size_t *)XMALLOC(maxBuckets * sizeof(size_t));
+
+  parallelScatter32(workers, threads, array, scratch, 0, count, PSORT_LOW_BITS, bucketStart);
+  bucketCount = PSORT_BUCKETS;
+
+  /* keys stay in scratch, a split goes through the list and is copied back */
+  for (int level = 1; level <= PSORT_SPLIT_LEVELS; ++level)
+  {
+    splitCount = 0;
+    for (b = 0; b < bucketCount; ++b)
+    {
+      if (bucketStart[b + 1] - bucketStart[b] <= count / threads)
+      {
+        splitStart[splitCount++] = bucketStart[b];
+        continue;
+      }
+
+      parallelScatter32(workers, threads, scratch, array, bucketStart[b], bucketStart[b + 1], PSORT_LOW_BITS - (8 * level), splitStart + splitCount);
+      runSortWorkers(workers, threads, sortCopyWorker);
+      splitCount += PSORT_BUCKETS;
+    }
+    splitStart[splitCount] = count;
+
+    if (splitCount EQ bucketCount)
+      break;
+
+    if (config->verbose)
+      fprintf(stderr, "Split large sort buckets into [%lu]\n", (unsigned long)splitCount);
+
+    tmpStart = bucketStart;
+    bucketStart = splitStart;
+    splitStart = tmpStart;
+    bucketCount = splitCount;
+  }
+
+  /* give each thread a run of buckets holding about count / threads keys */
+  for (t = 0, b = 0; t < threads; ++t)
+  {
+    target = (t EQ threads - 1) ? count : (count / threads) * (t + 1);
+    workers[t].src = scratch;
+    workers[t].dst = array;
+    workers[t].bucketStart = bucketStart;
+    workers[t].firstBucket = b;
+    while (b < bucketCount && (bucketStart[b + 1] <= target || b EQ workers[t].firstBucket))
+      b++;
+    if (t EQ threads - 1)
+      b = bucketCount;
+    workers[t].lastBucket = b;
+  }
+
+  runSortWorkers(workers, threads, sortBucketWorker);
+
+  XFREE(splitStart);
+  XFREE(bucketStart);
+  XFREE(scratch);
+  XFREE(workers);
+#else
+  radixSort32(array, count);
+#endif
+}
+
+/****
+ *
+ * find natural ascending runs, stops counting after maxRuns
+ *
+ * runStarts must hold maxRuns + 1 entries, the last one is set to count
+ *
+ ****/
+
+size_t findRuns32(const uint32_t array[], size_t count, size_t runStarts[], size_t maxRuns)
+{
+  size_t runCount = 0;
+
+  if (count EQ 0)
+  {
+    runStarts[0] = 0;
+    return (0);
+  }
+
+  runStarts[runCount++] = 0;
+  for (size_t i = 1; i < count; ++i)
+  {
+    if (array[i] < array[i - 1])
+    {
+      if (runCount EQ maxRuns)
+        return (maxRuns + 1);
+      runStarts[runCount++] = i;
+    }
+  }
+  runStarts[runCount] = count;
+
+  return (runCount);
+}
+
+/****
+ *
+ * first position in a sorted run where key belongs, upper or lower bound
+ *
+ ****/
+
+PRIVATE size_t searchRun32(const uint32_t array[], size_t count, uint32_t key, int upper)
+{
+  size_t low = 0, high = count, mid;
+
+  while (low < high)
+  {
+    mid = low + ((high - low) / 2);
+    if (array[mid] < key || (upper && array[mid] EQ key))
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return (low);
+}
+
+/****
+ *
+ * merge two adjacent sorted runs from src into dst
+ *
+ * like timsort, the head of the left run that is below the right run and
+ * the tail of the right run that is above the left run are copied without
+ * comparing
+ *
+ ****/
+
+PRIVATE void mergeTwoRuns32(const uint32_t *src, uint32_t *dst, size_t leftCount, size_t rightCount)
+{
+  const uint32_t *left = src, *right = src + leftCount;
+  size_t head, tail;
+
+  if (leftCount EQ 0 || rightCount EQ 0 || left[leftCount - 1] <= right[0])
+  {
+    memcpy(dst, src, (leftCount + rightCount) * sizeof(uint32_t));
+    return;
+  }
+
+  head = searchRun32(left, leftCount, right[0], TRUE);
+  tail = rightCount - searchRun32(right, rightCount, left[leftCount - 1], FALSE);
+
+  memcpy(dst, left, head * sizeof(uint32_t));
+  mergeSorted32(left + head, leftCount - head, right, rightCount - tail, dst + head);
+  memcpy(dst + leftCount + rightCount - tail, right + rightCount - tail, tail * sizeof(uint32_t));
+}
+
+/****
+ *
+ * merge sorted runs pairwise until one run is left
+ *
+ ****/
+
+void mergeRuns32(uint32_t array[], size_t count, size_t runStarts[], size_t runCount)
+{
+  uint32_t *scratch, *src = array, *dst, *tmpPtr;
+  size_t newRunCount, i;
+
+  if (runCount < 2)
+    return;
+
+  scratch = dst = (uint32_t *)XMALLOC(count * sizeof(uint32_t));
+
+  while (runCount > 1)
+  {
+    for (i = 0, newRunCount = 0; i < runCount; i += 2)
+    {
+      if (i + 1 < runCount)
+        mergeTwoRuns32(src + runStarts[i], dst + runStarts[i], runStarts[i + 1] - runStarts[i], runStarts[i + 2] - runStarts[i + 1]);
+      else
+        memcpy(dst + runStarts[i], src + runStarts[i], (runStarts[i + 1] - runStarts[i]) * sizeof(uint32_t));
+      runStarts[newRunCount++] = runStarts[i];
+    }
+    runStarts[newRunCount] = count;
+    runCount = newRunCount;
+
+    tmpPtr = src;
+    src = dst;
+    dst = tmpPtr;
+  }
+
+  if (src != array)
+    memcpy(array, src, count * sizeof(uint32_t));
+
+  XFREE(scratch);
+}
+
+/****
+ *
+ * sort ipv4 list with the configured algorithm
+ *
+ ****/
+
+void sortIPv4List(uint32_t array[], size_t count)
+{
+  sortIPv4ListCounted(array, count, NULL);
+}
+
+/****
+ *
+ * sort ipv4 list, hist is NULL or the radix histograms of the list
+ *
+ ****/
+
+void sortIPv4ListCounted(uint32_t array[], size_t count, size_t *hist)
+{
+  size_t runStarts[ADAPTIVE_MAX_RUNS + 1], runCount;
+
+  if (count < 2)
+    return;
+
+  /* feeds are often already sorted or a few sorted lists joined together */
+  if ((runCount = findRuns32(array, count, runStarts, ADAPTIVE_MAX_RUNS)) EQ 1)
+  {
+    if (config->verbose)
+      fprintf(stderr, "List is already sorted\n");
+    return;
+  }
+  else if (runCount <= ADAPTIVE_MAX_RUNS)
+  {
+    if (config->verbose)
+      fprintf(stderr, "Merging [%lu] sorted runs\n", (unsigned long)runCount);
+    mergeRuns32(array, count, runStarts, runCount);
+    return;
+  }
+
+  switch (config->sortType)
+  {
+  case SORT_QUICK:
+    if (config->verbose)
+      fprintf(stderr, "Using quick sort\n");
+    quickSort32(array, 0, count - 1);
+    break;
+
+  default:
+    if (config->threads > 1 && count >= PARALLEL_SORT_MIN_COUNT)
+    {
+      if (config->verbose)
+        fprintf(stderr, "Using parallel radix sort with [%d] threads\n", config->threads);
+      parallelRadixSort32(array, count, config->threads);
+    }
+    else if (hist != NULL)
+    {
+      if (config->verbose)
+        fprintf(stderr, "Using radix sort with prebuilt histograms\n");
+      radixSort32Counted(array, count, hist);
+    }
+    else
+    {
+      if (config->verbose)
+        fprintf(stderr, "Using radix sort\n");
+      radixSort32(array, count);
+    }
+  }
+}
+
+/****
+ *
+ * sort ranges by start address
+ *
+ ****/
+
+void sortRanges(struct ipv4Range_s ranges[], size_t count)
+{
+  if (count > 1)
+    qsort(ranges, count, sizeof(struct ipv4Range_s), compareRanges);
 }
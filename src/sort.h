@@ -42,14 +42,71 @@
 #include "mem.h"
 #include "util.h"
 #include "../include/common.h"
+#include "vector.h"
 #include <stdint.h>
 
+/****
+ *
+ * defines
+ *
+ ****/
+
+#if defined(HAVE_IMMINTRIN_H) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_SORT 1
+#endif
+
+#define SORT_DEFAULT 0
+#define SORT_RADIX 1
+#define SORT_QUICK 2
+
+/* 3 passes of 11 bits cover a 32 bit key */
+#define RADIX_BITS 11
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_MASK (RADIX_BUCKETS - 1)
+#define RADIX_PASSES 3
+
+/* quick sort hands partitions this small to the sorting network */
+#define SORT_NETWORK_MAX 64
+/* below this the network padding costs more than an insertion sort */
+#define SORT_NETWORK_MIN 8
+
+/* below this an insertion sort is faster than the histogram passes */
+#define RADIX_MIN_COUNT 64
+
+/* merge natural runs instead of sorting when there are this few */
+#define ADAPTIVE_MAX_RUNS 32
+
+/* parallel sort partitions on the top 8 bits, then sorts the low 24 */
+#define PSORT_TOP_BITS 8
+#define PSORT_BUCKETS (1 << PSORT_TOP_BITS)
+#define PSORT_LOW_BITS (32 - PSORT_TOP_BITS)
+#define PSORT_LOW_PASSES 3
+
+/* buckets over count / threads keys are split on the next byte, then the one after */
+#define PSORT_SPLIT_LEVELS 2
+
+/* below this the thread startup costs more than it saves */
+#define PARALLEL_SORT_MIN_COUNT (1024 * 1024)
+
 /****
  *
  * typedefs and enums
  *
  ****/
 
+struct sortWorker_s
+{
+  uint32_t *src;
+  uint32_t *dst;
+  size_t start;
+  size_t end;
+  int shift;
+  size_t firstBucket;
+  size_t lastBucket;
+  size_t *bucketStart;
+  size_t hist[PSORT_BUCKETS];
+};
+
 /****
  *
  * function prototypes
@@ -58,5 +115,18 @@
 
 uint32_t quickSortPartition32( uint32_t a[], uint32_t low, uint32_t high);
 void quickSort32(uint32_t a[], uint32_t low, uint32_t high);
+void insertionSort32(uint32_t array[], size_t count);
+void smallSort32(uint32_t array[], size_t count);
+void mergeSorted32(const uint32_t *a, size_t aCount, const uint32_t *b, size_t bCount, uint32_t *dst);
+void initSort(void);
+void radixHistogram32(const uint32_t array[], size_t count, size_t *hist);
+void radixSort32(uint32_t array[], size_t count);
+void radixSort32Counted(uint32_t array[], size_t count, size_t *hist);
+void parallelRadixSort32(uint32_t array[], size_t count, int threads);
+size_t findRuns32(const uint32_t array[], size_t count, size_t runStarts[], size_t maxRuns);
+void mergeRuns32(uint32_t array[], size_t count, size_t runStarts[], size_t runCount);
+void sortIPv4List(uint32_t array[], size_t count);
+void sortIPv4ListCounted(uint32_t array[], size_t count, size_t *hist);
+void sortRanges(struct ipv4Range_s ranges[], size_t count);
 
 #endif /* end of SORT_DOT_H */
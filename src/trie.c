@@ -0,0 +1,497 @@
+/*****
+ *
+ * Description: Binary radix trie
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "trie.h"
+
+/****
+ *
+ * external variables
+ *
+ ****/
+
+extern Config_t *config;
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * prefix helpers
+ *
+ ****/
+
+PRIVATE inline uint32_t prefixMask(int len)
+{
+  return ((len EQ 0) ? 0 : 0xffffffff << (32 - len));
+}
+
+PRIVATE inline uint64_t blockSize(int len)
+{
+  return ((uint64_t)1 << (32 - len));
+}
+
+/* bit that picks the child below a prefix of this length */
+PRIVATE inline int prefixBit(uint32_t addr, int len)
+{
+  return ((addr >> (31 - len)) & 1);
+}
+
+/* leading bits that two prefixes share, up to maxLen */
+PRIVATE inline int commonLen(uint32_t a, uint32_t b, int maxLen)
+{
+  uint32_t diff = a ^ b;
+  int len = 0;
+
+  if (diff EQ 0)
+    return (maxLen);
+#ifdef __GNUC__
+  len = __builtin_clz(diff);
+#else
+  while (!(diff & 0x80000000))
+  {
+    diff <<= 1;
+    len++;
+  }
+#endif
+
+  return ((len < maxLen) ? len : maxLen);
+}
+
+/****
+ *
+ * init an empty trie
+ *
+ ****/
+
+void initTrie(struct trie_s *trie)
+{
+  XMEMSET(trie, 0, sizeof(struct trie_s));
+}
+
+/****
+ *
+ * get a node from the free list or the current block
+ *
+ ****/
+
+PRIVATE struct trieNode_s *newTrieNode(struct trie_s *trie, uint32_t prefix, int len, int full)
+{
+  struct trieNode_s *node;
+  struct trieBlock_s *block;
+
+  if (trie->freeList != NULL)
+  {
+    node = trie->freeList;
+    trie->freeList = node->child[0];
+  }
+  else
+  {
+    if (trie->blocks EQ NULL || trie->blockUsed EQ TRIE_BLOCK_NODES)
+    {
+      if ((block = (struct trieBlock_s *)XMALLOC(sizeof(struct trieBlock_s))) EQ NULL)
+      {
+        fprintf(stderr, "ERR - Unable to allocate memory for trie nodes\n");
+        return (NULL);
+      }
+      block->next = trie->blocks;
+      trie->blocks = block;
+      trie->blockUsed = 0;
+    }
+    node = &trie->blocks->nodes[trie->blockUsed++];
+  }
+
+  node->child[0] = node->child[1] = NULL;
+  node->prefix = prefix & prefixMask(len);
+  node->len = len;
+  node->full = full;
+  node->population = (full) ? blockSize(len) : 0;
+  trie->nodeCount++;
+
+  return (node);
+}
+
+/****
+ *
+ * return a subtree to the free list
+ *
+ ****/
+
+PRIVATE void freeTrieNodes(struct trie_s *trie, struct trieNode_s *node)
+{
+  if (node EQ NULL)
+    return;
+
+  freeTrieNodes(trie, node->child[0]);
+  freeTrieNodes(trie, node->child[1]);
+
+  node->child[0] = trie->freeList;
+  trie->freeList = node;
+  trie->nodeCount--;
+}
+
+/****
+ *
+ * turn a node into a full prefix
+ *
+ ****/
+
+PRIVATE void fillTrieNode(struct trie_s *trie, struct trieNode_s *node)
+{
+  freeTrieNodes(trie, node->child[0]);
+  freeTrieNodes(trie, node->child[1]);
+  node->child[0] = node->child[1] = NULL;
+  node->full = TRUE;
+  node->population = blockSize(node->len);
+}
+
+/****
+ *
+ * insert a prefix below slot, added is set to the new addresses
+ *
+ ****/
+
+PRIVATE int insertTrieNode(struct trie_s *trie, struct trieNode_s **slot, uint32_t prefix, int len, uint64_t *added)
+{
+  struct trieNode_s *node = *slot, *parent, *leaf;
+  int common, bit;
+
+  if (node EQ NULL)
+  {
+    if ((*slot = newTrieNode(trie, prefix, len, TRUE)) EQ NULL)
+      return (FAILED);
+    *added = blockSize(len);
+    return (TRUE);
+  }
+
+  common = commonLen(node->prefix, prefix, (node->len < len) ? node->len : len);
+
+  if (common < node->len)
+  {
+    if (common EQ len)
+    {
+      /* the new prefix covers the whole node */
+      *added = blockSize(len) - node->population;
+      node->prefix = prefix & prefixMask(len);
+      node->len = len;
+      fillTrieNode(trie, node);
+      return (TRUE);
+    }
+
+    /* split at the first bit that differs */
+    if ((leaf = newTrieNode(trie, prefix, len, TRUE)) EQ NULL)
+      return (FAILED);
+    if ((parent = newTrieNode(trie, prefix, common, FALSE)) EQ NULL)
+    {
+      freeTrieNodes(trie, leaf);
+      return (FAILED);
+    }
+    bit = prefixBit(prefix, common);
+    parent->child[bit] = leaf;
+    parent->child[!bit] = node;
+    parent->population = node->population + leaf->population;
+    *slot = parent;
+    *added = leaf->population;
+    return (TRUE);
+  }
+
+  if (node->full)
+  {
+    *added = 0;
+    return (TRUE);
+  }
+
+  if (len EQ node->len)
+  {
+    *added = blockSize(len) - node->population;
+    fillTrieNode(trie, node);
+    return (TRUE);
+  }
+
+  if (insertTrieNode(trie, &node->child[prefixBit(prefix, node->len)], prefix, len, added) EQ FAILED)
+    return (FAILED);
+
+  /* two full halves make a full node */
+  if ((node->population += *added) EQ blockSize(node->len))
+    fillTrieNode(trie, node);
+
+  return (TRUE);
+}
+
+/****
+ *
+ * add every address in prefix/len
+ *
+ ****/
+
+int trieInsert(struct trie_s *trie, uint32_t prefix, int len)
+{
+  uint64_t added = 0;
+
+  return (insertTrieNode(trie, &trie->root, prefix, len, &added));
+}
+
+/****
+ *
+ * remove a prefix below slot, removed is set to the dropped addresses
+ *
+ ****/
+
+PRIVATE int deleteTrieNode(struct trie_s *trie, struct trieNode_s **slot, uint32_t prefix, int len, uint64_t *removed)
+{
+  struct trieNode_s *node = *slot;
+  int minLen;
+
+  *removed = 0;
+  if (node EQ NULL)
+    return (TRUE);
+
+  minLen = (node->len < len) ? node->len : len;
+  if (commonLen(node->prefix, prefix, minLen) < minLen)
+    return (TRUE);
+
+  if (node->len >= len)
+  {
+    /* node is inside the prefix */
+    *removed = node->population;
+    freeTrieNodes(trie, node);
+    *slot = NULL;
+    return (TRUE);
+  }
+
+  if (node->full)
+  {
+    /* split the full node so the hole can be cut out of one half */
+    if ((node->child[0] = newTrieNode(trie, node->prefix, node->len + 1, TRUE)) EQ NULL)
+      return (FAILED);
+    if ((node->child[1] = newTrieNode(trie, node->prefix | (0x80000000 >> node->len), node->len + 1, TRUE)) EQ NULL)
+    {
+      freeTrieNodes(trie, node->child[0]);
+      node->child[0] = NULL;
+      return (FAILED);
+    }
+    node->full = FALSE;
+  }
+
+  if (deleteTrieNode(trie, &node->child[prefixBit(prefix, node->len)], prefix, len, removed) EQ FAILED)
+    return (FAILED);
+  node->population -= *removed;
+
+  if (node->child[0] EQ NULL || node->child[1] EQ NULL)
+  {
+    /* the remaining child takes the node's place */
+    *slot = (node->child[0] != NULL) ? node->child[0] : node->child[1];
+    node->child[0] = node->child[1] = NULL;
+    freeTrieNodes(trie, node);
+  }
+
+  return (TRUE);
+}
+
+/****
+ *
+ * remove every address in prefix/len
+ *
+ ****/
+
+int trieDelete(struct trie_s *trie, uint32_t prefix, int len)
+{
+  uint64_t removed;
+
+  return (deleteTrieNode(trie, &trie->root, prefix & prefixMask(len), len, &removed));
+}
+
+/****
+ *
+ * true when addr is in the trie
+ *
+ ****/
+
+int trieContains(struct trie_s *trie, uint32_t addr)
+{
+  struct trieNode_s *node = trie->root;
+
+  while (node != NULL)
+  {
+    if (commonLen(node->prefix, addr, node->len) < node->len)
+      return (FALSE);
+    if (node->full)
+      return (TRUE);
+    node = node->child[prefixBit(addr, node->len)];
+  }
+
+  return (FALSE);
+}
+
+/****
+ *
+ * number of addresses under prefix/len
+ *
+ ****/
+
+uint64_t triePopulation(struct trie_s *trie, uint32_t prefix, int len)
+{
+  struct trieNode_s *node = trie->root;
+  int minLen;
+
+  while (node != NULL)
+  {
+    minLen = (node->len < len) ? node->len : len;
+    if (commonLen(node->prefix, prefix, minLen) < minLen)
+      return (0);
+    if (node->len >= len)
+      return (node->population);
+    if (node->full)
+      return (blockSize(len));
+    node = node->child[prefixBit(prefix, node->len)];
+  }
+
+  return (0);
+}
+
+/****
+ *
+ * add the addresses under a node to the leftover hosts and ranges
+ *
+ ****/
+
+PRIVATE int trieLeftovers(struct trieNode_s *node, struct addrVector_s *hosts, struct rangeVector_s *ranges)
+{
+  if (node EQ NULL)
+    return (TRUE);
+
+  if (node->full && node->len EQ 32)
+  {
+    if (hosts->count EQ hosts->size && growAddrVector(hosts, hosts->count + 1) EQ FAILED)
+      return (FAILED);
+    hosts->list[hosts->count++] = node->prefix;
+    return (TRUE);
+  }
+
+  if (node->full)
+    return (addRangeVector(ranges, node->prefix, node->prefix | ~prefixMask(node->len)));
+
+  if (trieLeftovers(node->child[0], hosts, ranges) EQ FAILED)
+    return (FAILED);
+  return (trieLeftovers(node->child[1], hosts, ranges));
+}
+
+/****
+ *
+ * consolidate the subtree under a node
+ *
+ * the blocks between the parent and the node only hold this subtree, so
+ * they share its population.  the first block, largest first, that
+ * reaches minCount is kept and nothing under it is visited.
+ *
+ ****/
+
+PRIVATE int consolidateTrieNode(struct trieNode_s *node, int parentLen, const uint64_t minCount[], int minBits, int maxBits, struct cidrVector_s *cidrs, struct addrVector_s *hosts, struct rangeVector_s *ranges)
+{
+  int first, last;
+
+  if (node EQ NULL)
+    return (TRUE);
+
+  first = (parentLen + 1 > minBits) ? parentLen + 1 : minBits;
+  last = (node->len < maxBits) ? node->len : maxBits;
+  for (int len = first; len <= last; ++len)
+    if (node->population >= minCount[len])
+      return (addCidrVector(cidrs, node->prefix & prefixMask(len), len));
+
+  if (node->len >= maxBits)
+    return (trieLeftovers(node, hosts, ranges));
+
+  if (node->full)
+  {
+    /* every block inside a full node is full */
+    first = (node->len + 1 > minBits) ? node->len + 1 : minBits;
+    for (int len = first; len <= maxBits; ++len)
+      if (blockSize(len) >= minCount[len])
+      {
+        for (uint64_t b = 0; b < ((uint64_t)1 << (len - node->len)); ++b)
+          if (addCidrVector(cidrs, node->prefix + (uint32_t)(b << (32 - len)), len) EQ FAILED)
+            return (FAILED);
+        return (TRUE);
+      }
+
+    return (trieLeftovers(node, hosts, ranges));
+  }
+
+  if (consolidateTrieNode(node->child[0], node->len, minCount, minBits, maxBits, cidrs, hosts, ranges) EQ FAILED)
+    return (FAILED);
+  return (consolidateTrieNode(node->child[1], node->len, minCount, minBits, maxBits, cidrs, hosts, ranges));
+}
+
+/****
+ *
+ * consolidate the trie in one traversal
+ *
+ * kept blocks go to cidrs in address order, addresses that are not in a
+ * kept block go to hosts and ranges.
+ *
+ ****/
+
+int consolidateTrie(struct trie_s *trie, const uint64_t minCount[], int minBits, int maxBits, struct cidrVector_s *cidrs, struct addrVector_s *hosts, struct rangeVector_s *ranges)
+{
+  return (consolidateTrieNode(trie->root, -1, minCount, minBits, maxBits, cidrs, hosts, ranges));
+}
+
+/****
+ *
+ * free all trie nodes
+ *
+ ****/
+
+void freeTrie(struct trie_s *trie)
+{
+  struct trieBlock_s *block;
+
+  while ((block = trie->blocks) != NULL)
+  {
+    trie->blocks = block->next;
+    XFREE(block);
+  }
+
+  XMEMSET(trie, 0, sizeof(struct trie_s));
+}
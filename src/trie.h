@@ -0,0 +1,118 @@
+/*****
+ *
+ * Description: Binary radix trie
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+#ifndef TRIE_DOT_H
+#define TRIE_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+#include "mem.h"
+#include "vector.h"
+#include <stdint.h>
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+/* nodes are carved from blocks this size */
+#define TRIE_BLOCK_NODES 65536
+
+/****
+ *
+ * typedefs & structs
+ *
+ ****/
+
+/*
+ * a node is a prefix with the number of addresses stored under it.  full
+ * nodes hold every address in the prefix and have no children, the other
+ * nodes always have two children.
+ */
+struct trieNode_s
+{
+  struct trieNode_s *child[2];
+  uint64_t population;
+  uint32_t prefix;
+  uint8_t len;
+  uint8_t full;
+};
+
+struct trieBlock_s
+{
+  struct trieBlock_s *next;
+  struct trieNode_s nodes[TRIE_BLOCK_NODES];
+};
+
+struct trie_s
+{
+  struct trieNode_s *root;
+  struct trieNode_s *freeList;
+  struct trieBlock_s *blocks;
+  size_t blockUsed;
+  uint64_t nodeCount;
+};
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+void initTrie(struct trie_s *trie);
+int trieInsert(struct trie_s *trie, uint32_t prefix, int len);
+int trieDelete(struct trie_s *trie, uint32_t prefix, int len);
+int trieContains(struct trie_s *trie, uint32_t addr);
+uint64_t triePopulation(struct trie_s *trie, uint32_t prefix, int len);
+int consolidateTrie(struct trie_s *trie, const uint64_t minCount[], int minBits, int maxBits, struct cidrVector_s *cidrs, struct addrVector_s *hosts, struct rangeVector_s *ranges);
+void freeTrie(struct trie_s *trie);
+
+#endif /* TRIE_DOT_H */
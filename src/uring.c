@@ -0,0 +1,329 @@
+/*****
+ *
+ * Description: io_uring Input Reader
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "uring.h"
+
+/****
+ *
+ * external variables
+ *
+ ****/
+
+extern int errno;
+extern Config_t *config;
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+#ifdef HAVE_IO_URING
+
+/****
+ *
+ * queue a read for the rest of a block
+ *
+ ****/
+
+PRIVATE void uringPush(struct uringReader_s *reader, int blockNum)
+{
+  struct uringBlock_s *b = &reader->blocks[blockNum];
+  struct io_uring_sqe *sqe;
+  unsigned tail = *reader->sqTail;
+  unsigned idx = tail & *reader->sqMask;
+
+  sqe = &reader->sqes[idx];
+  XMEMSET(sqe, 0, sizeof(struct io_uring_sqe));
+  b->iov.iov_base = b->data + b->len;
+  b->iov.iov_len = b->size - b->len;
+  sqe->opcode = IORING_OP_READV;
+  sqe->fd = reader->fd;
+  sqe->addr = (uint64_t)(uintptr_t)&b->iov;
+  sqe->len = 1;
+  sqe->off = (uint64_t)(b->offset + (off_t)b->len);
+  sqe->user_data = (uint64_t)blockNum;
+  reader->sqArray[idx] = idx;
+  __atomic_store_n(reader->sqTail, tail + 1, __ATOMIC_RELEASE);
+  reader->toSubmit++;
+  b->pending = TRUE;
+}
+
+/****
+ *
+ * submit queued reads and wait for at least minComplete of them
+ *
+ ****/
+
+PRIVATE int uringEnter(struct uringReader_s *reader, unsigned minComplete)
+{
+  struct uringBlock_s *b;
+  struct io_uring_cqe *cqe;
+  unsigned head, tail;
+  int ret;
+
+  while (reader->toSubmit > 0 || minComplete > 0)
+  {
+    if ((ret = (int)syscall(__NR_io_uring_enter, reader->ringFd, reader->toSubmit, minComplete,
+                            (minComplete > 0) ? IORING_ENTER_GETEVENTS : 0, NULL, 0)) EQ FAILED)
+    {
+      if (errno EQ EINTR || errno EQ EAGAIN)
+        continue;
+      return (FAILED);
+    }
+    reader->toSubmit -= (unsigned)ret;
+    if (minComplete EQ 0)
+      break;
+
+    /* reap whatever has completed */
+    head = *reader->cqHead;
+    tail = __atomic_load_n(reader->cqTail, __ATOMIC_ACQUIRE);
+    if (head EQ tail)
+      continue;
+    for (; head != tail; ++head)
+    {
+      cqe = &reader->cqes[head & *reader->cqMask];
+      b = &reader->blocks[cqe->user_data];
+
+      if (cqe->res > 0)
+        b->len += (size_t)cqe->res;
+      else if (cqe->res EQ 0)
+        b->size = b->len;
+      else if (cqe->res != -EINTR && cqe->res != -EAGAIN)
+      {
+        b->error = -cqe->res;
+        b->size = b->len;
+      }
+      b->pending = FALSE;
+    }
+    __atomic_store_n(reader->cqHead, head, __ATOMIC_RELEASE);
+    minComplete = 0;
+
+    /* short reads are continued where they stopped */
+    for (int i = 0; i < URING_DEPTH; ++i)
+    {
+      b = &reader->blocks[i];
+      if (!b->pending && b->len < b->size)
+        uringPush(reader, i);
+    }
+  }
+
+  return (TRUE);
+}
+
+/****
+ *
+ * point a drained block at the next part of the file and queue it
+ *
+ ****/
+
+PRIVATE void uringQueueBlock(struct uringReader_s *reader, int blockNum)
+{
+  struct uringBlock_s *b = &reader->blocks[blockNum];
+
+  b->offset = reader->nextOffset;
+  b->len = 0;
+  if (reader->nextOffset >= reader->fileSize)
+  {
+    b->size = 0;
+    return;
+  }
+  b->size = (reader->fileSize - reader->nextOffset > URING_BLOCK_SIZE) ? URING_BLOCK_SIZE : (size_t)(reader->fileSize - reader->nextOffset);
+  reader->nextOffset += (off_t)b->size;
+  uringPush(reader, blockNum);
+}
+
+/****
+ *
+ * set up a ring for fd and start the first reads, NULL if io_uring is not usable
+ *
+ ****/
+
+struct uringReader_s *initUringReader(int fd, off_t fileSize)
+{
+  struct uringReader_s *reader;
+  struct io_uring_params p;
+
+  reader = (struct uringReader_s *)XMALLOC(sizeof(struct uringReader_s));
+  reader->fd = fd;
+  reader->fileSize = fileSize;
+  reader->sqRing = reader->cqRing = reader->sqes = MAP_FAILED;
+  reader->blockMem = MAP_FAILED;
+
+  XMEMSET(&p, 0, sizeof(p));
+  if ((reader->ringFd = (int)syscall(__NR_io_uring_setup, URING_DEPTH, &p)) EQ FAILED)
+  {
+    if (config->verbose)
+      fprintf(stderr, "Unable to set up io_uring %d (%s)\n", errno, strerror(errno));
+    XFREE(reader);
+    return (NULL);
+  }
+
+  reader->sqRingLen = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  reader->cqRingLen = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    if (reader->cqRingLen > reader->sqRingLen)
+      reader->sqRingLen = reader->cqRingLen;
+    reader->cqRingLen = 0;
+  }
+  reader->sqesLen = p.sq_entries * sizeof(struct io_uring_sqe);
+
+  if ((reader->sqRing = mmap(NULL, reader->sqRingLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, reader->ringFd, IORING_OFF_SQ_RING)) EQ MAP_FAILED ||
+      (reader->cqRing = (reader->cqRingLen EQ 0) ? reader->sqRing : mmap(NULL, reader->cqRingLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, reader->ringFd, IORING_OFF_CQ_RING)) EQ MAP_FAILED ||
+      (reader->sqes = mmap(NULL, reader->sqesLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, reader->ringFd, IORING_OFF_SQES)) EQ MAP_FAILED ||
+      (reader->blockMem = mmap(NULL, (size_t)URING_DEPTH * URING_BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) EQ MAP_FAILED)
+  {
+    if (config->verbose)
+      fprintf(stderr, "Unable to map io_uring queues %d (%s)\n", errno, strerror(errno));
+    freeUringReader(reader);
+    return (NULL);
+  }
+
+  reader->sqHead = (unsigned *)((char *)reader->sqRing + p.sq_off.head);
+  reader->sqTail = (unsigned *)((char *)reader->sqRing + p.sq_off.tail);
+  reader->sqMask = (unsigned *)((char *)reader->sqRing + p.sq_off.ring_mask);
+  reader->sqArray = (unsigned *)((char *)reader->sqRing + p.sq_off.array);
+  reader->cqHead = (unsigned *)((char *)reader->cqRing + p.cq_off.head);
+  reader->cqTail = (unsigned *)((char *)reader->cqRing + p.cq_off.tail);
+  reader->cqMask = (unsigned *)((char *)reader->cqRing + p.cq_off.ring_mask);
+  reader->cqes = (struct io_uring_cqe *)((char *)reader->cqRing + p.cq_off.cqes);
+
+  for (int i = 0; i < URING_DEPTH; ++i)
+  {
+    reader->blocks[i].data = reader->blockMem + (size_t)i * URING_BLOCK_SIZE;
+    uringQueueBlock(reader, i);
+  }
+
+  if (uringEnter(reader, 0) EQ FAILED)
+  {
+    if (config->verbose)
+      fprintf(stderr, "Unable to submit io_uring reads %d (%s)\n", errno, strerror(errno));
+    freeUringReader(reader);
+    return (NULL);
+  }
+
+  return (reader);
+}
+
+/****
+ *
+ * hand out the next block of the file in place, 0 at the end of the file
+ *
+ * the block handed out before is requeued first, so its data is only good
+ * until the next call.
+ *
+ ****/
+
+ssize_t uringNextBlock(struct uringReader_s *reader, char **data)
+{
+  struct uringBlock_s *b;
+
+  if (reader->handedOut)
+  {
+    /* the scanner is done with it, send it further down the file */
+    reader->handedOut = FALSE;
+    uringQueueBlock(reader, reader->head);
+    reader->head = (reader->head + 1) % URING_DEPTH;
+    if (uringEnter(reader, 0) EQ FAILED)
+      return (FAILED);
+  }
+
+  b = &reader->blocks[reader->head];
+
+  while (b->pending)
+    if (uringEnter(reader, 1) EQ FAILED)
+      return (FAILED);
+
+  if (b->error)
+  {
+    errno = b->error;
+    b->error = 0;
+    return (FAILED);
+  }
+
+  /* end of file, or it was truncated under us */
+  if (b->len EQ 0)
+    return (0);
+
+  *data = b->data;
+  reader->handedOut = TRUE;
+
+  return ((ssize_t)b->len);
+}
+
+/****
+ *
+ * wait for outstanding reads and tear down the ring
+ *
+ ****/
+
+void freeUringReader(struct uringReader_s *reader)
+{
+  if (reader EQ NULL)
+    return;
+
+  if (reader->blockMem != MAP_FAILED)
+  {
+    /* let reads still in flight land before their buffers go away */
+    for (int i = 0; i < URING_DEPTH; ++i)
+      reader->blocks[i].size = 0;
+    for (int i = 0; i < URING_DEPTH; ++i)
+      while (reader->blocks[i].pending)
+        if (uringEnter(reader, 1) EQ FAILED)
+          break;
+  }
+
+  if (reader->ringFd >= 0)
+    close(reader->ringFd);
+  if (reader->blockMem != MAP_FAILED)
+    munmap(reader->blockMem, (size_t)URING_DEPTH * URING_BLOCK_SIZE);
+  if (reader->sqes != MAP_FAILED)
+    munmap(reader->sqes, reader->sqesLen);
+  if (reader->cqRing != MAP_FAILED && reader->cqRing != reader->sqRing)
+    munmap(reader->cqRing, reader->cqRingLen);
+  if (reader->sqRing != MAP_FAILED)
+    munmap(reader->sqRing, reader->sqRingLen);
+
+  XFREE(reader);
+}
+
+#endif /* HAVE_IO_URING */
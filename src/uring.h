@@ -0,0 +1,143 @@
+/*****
+ *
+ * Description: io_uring Input Reader Headers
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+#ifndef URING_DOT_H
+#define URING_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+#include "mem.h"
+#include <stdint.h>
+
+#if defined(HAVE_LINUX_IO_URING_H) && defined(HAVE_SYS_SYSCALL_H) && defined(HAVE_MMAP)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+/* reads kept in flight */
+#define URING_DEPTH 4
+
+/* size of each read, buffers are page aligned */
+#define URING_BLOCK_SIZE (4 * 1024 * 1024)
+
+/****
+ *
+ * typedefs & structs
+ *
+ ****/
+
+#ifdef HAVE_IO_URING
+struct uringBlock_s
+{
+  char *data;
+  struct iovec iov;
+  off_t offset;
+  size_t size;
+  size_t len;
+  int pending;
+  int error;
+};
+
+/*
+ * reads a regular file front to back with URING_DEPTH reads queued at
+ * consecutive offsets.  blocks are handed to the line scanner in file order
+ * and requeued further ahead once it asks for the next one.
+ */
+struct uringReader_s
+{
+  int ringFd;
+  int fd;
+  off_t fileSize;
+  off_t nextOffset;
+  int head;
+  int handedOut;
+  unsigned toSubmit;
+  char *blockMem;
+  void *sqRing;
+  void *cqRing;
+  size_t sqRingLen;
+  size_t cqRingLen;
+  struct io_uring_sqe *sqes;
+  size_t sqesLen;
+  unsigned *sqHead;
+  unsigned *sqTail;
+  unsigned *sqMask;
+  unsigned *sqArray;
+  unsigned *cqHead;
+  unsigned *cqTail;
+  unsigned *cqMask;
+  struct io_uring_cqe *cqes;
+  struct uringBlock_s blocks[URING_DEPTH];
+};
+#endif
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+#ifdef HAVE_IO_URING
+struct uringReader_s *initUringReader(int fd, off_t fileSize);
+ssize_t uringNextBlock(struct uringReader_s *reader, char **data);
+void freeUringReader(struct uringReader_s *reader);
+#endif
+
+#endif /* URING_DOT_H */
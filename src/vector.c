@@ -0,0 +1,252 @@
+/*****
+ *
+ * Description: Address Vector Functions
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "vector.h"
+
+/****
+ *
+ * external variables
+ *
+ ****/
+
+extern Config_t *config;
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * allocate vector sized from the expected number of input lines, capped at
+ * MAX_INITIAL_VECTOR_SIZE.  it never grows past maxSize addresses (0 for
+ * no limit)
+ *
+ ****/
+
+int initAddrVector(struct addrVector_s *vec, off_t inputSize, size_t maxSize)
+{
+  size_t size = DEFAULT_VECTOR_SIZE;
+
+  if (maxSize EQ 0 || maxSize > MAX_VECTOR_SIZE)
+    maxSize = MAX_VECTOR_SIZE;
+
+  /* the estimate is only a starting point, xmalloc_() zeroes what it hands out */
+  if (inputSize > 0 && (uint64_t)inputSize / AVG_LINE_LEN > size)
+    size = ((uint64_t)inputSize / AVG_LINE_LEN > MAX_INITIAL_VECTOR_SIZE) ? MAX_INITIAL_VECTOR_SIZE : (size_t)(inputSize / AVG_LINE_LEN);
+  if (size > maxSize)
+    size = maxSize;
+
+#ifdef DEBUG
+  if (config->debug >= 3)
+    fprintf(stderr, "DEBUG - Initial IPv4 address buffer size [%lu]\n", (unsigned long)size);
+#endif
+
+  vec->count = 0;
+  vec->size = size;
+  vec->maxSize = maxSize;
+  if ((vec->list = (uint32_t *)XMALLOC(size * sizeof(uint32_t))) EQ NULL)
+    return (FAILED);
+
+  return (TRUE);
+}
+
+/****
+ *
+ * grow vector by doubling until it holds at least minSize addresses
+ *
+ ****/
+
+int growAddrVector(struct addrVector_s *vec, size_t minSize)
+{
+  uint32_t *tmpPtr;
+  size_t newSize = (vec->size > 0) ? vec->size : DEFAULT_VECTOR_SIZE;
+
+  if (minSize > vec->maxSize)
+  {
+    fprintf(stderr, "ERR - IPv4 address buffer can not hold more than %lu addresses\n", (unsigned long)vec->maxSize);
+    return (FAILED);
+  }
+
+  while (newSize < minSize)
+    newSize *= 2;
+  if (newSize > vec->maxSize)
+    newSize = vec->maxSize;
+
+  if ((tmpPtr = XREALLOC(vec->list, newSize * sizeof(uint32_t))) EQ NULL)
+    return (FAILED);
+
+  vec->list = tmpPtr;
+  vec->size = newSize;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * release unused space at the end of the vector
+ *
+ ****/
+
+void shrinkAddrVector(struct addrVector_s *vec)
+{
+  uint32_t *tmpPtr;
+
+  if (vec->count EQ 0 || vec->count EQ vec->size)
+    return;
+
+  if ((tmpPtr = XREALLOC(vec->list, vec->count * sizeof(uint32_t))) != NULL)
+  {
+    vec->list = tmpPtr;
+    vec->size = vec->count;
+  }
+}
+
+/****
+ *
+ * free vector
+ *
+ ****/
+
+void freeAddrVector(struct addrVector_s *vec)
+{
+  if (vec->list != NULL)
+    XFREE(vec->list);
+  vec->list = NULL;
+  vec->count = vec->size = 0;
+}
+
+/****
+ *
+ * append a range, the vector grows by doubling
+ *
+ ****/
+
+int addRangeVector(struct rangeVector_s *vec, uint32_t start, uint32_t end)
+{
+  struct ipv4Range_s *tmpPtr;
+  size_t newSize;
+
+  if (vec->count EQ vec->size)
+  {
+    newSize = (vec->size > 0) ? vec->size * 2 : DEFAULT_RANGE_VECTOR_SIZE;
+    if (newSize > (size_t)INT_MAX / sizeof(struct ipv4Range_s))
+    {
+      fprintf(stderr, "ERR - CIDR range buffer can not hold more than %lu ranges\n", (unsigned long)vec->size);
+      return (FAILED);
+    }
+
+    if ((tmpPtr = XREALLOC(vec->list, newSize * sizeof(struct ipv4Range_s))) EQ NULL)
+      return (FAILED);
+
+    vec->list = tmpPtr;
+    vec->size = newSize;
+  }
+
+  vec->list[vec->count].start = start;
+  vec->list[vec->count].end = end;
+  vec->count++;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * free range vector
+ *
+ ****/
+
+void freeRangeVector(struct rangeVector_s *vec)
+{
+  if (vec->list != NULL)
+    XFREE(vec->list);
+  vec->list = NULL;
+  vec->count = vec->size = 0;
+}
+
+/****
+ *
+ * append a cidr block, growing the vector by doubling
+ *
+ ****/
+
+int addCidrVector(struct cidrVector_s *vec, uint32_t network, uint32_t mask)
+{
+  struct cidr_s *tmpPtr;
+  size_t newSize;
+
+  if (vec->count EQ vec->size)
+  {
+    newSize = (vec->size > 0) ? vec->size * 2 : DEFAULT_RANGE_VECTOR_SIZE;
+    if (newSize > (size_t)INT_MAX / sizeof(struct cidr_s))
+    {
+      fprintf(stderr, "ERR - CIDR buffer can not hold more than %lu blocks\n", (unsigned long)vec->size);
+      return (FAILED);
+    }
+
+    if ((tmpPtr = XREALLOC(vec->list, newSize * sizeof(struct cidr_s))) EQ NULL)
+      return (FAILED);
+
+    vec->list = tmpPtr;
+    vec->size = newSize;
+  }
+
+  vec->list[vec->count].network = network;
+  vec->list[vec->count].mask = mask;
+  vec->count++;
+
+  return (TRUE);
+}
+
+/****
+ *
+ * free the cidr vector
+ *
+ ****/
+
+void freeCidrVector(struct cidrVector_s *vec)
+{
+  if (vec->list != NULL)
+    XFREE(vec->list);
+  vec->list = NULL;
+  vec->count = vec->size = 0;
+}
@@ -0,0 +1,136 @@
+/*****
+ *
+ * Description: Address Vector Headers
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2008-2023, Ron Dilley
+ * All rights reserved.
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****/
+
+#ifndef VECTOR_DOT_H
+#define VECTOR_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+#include "mem.h"
+#include <limits.h>
+#include <stdint.h>
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+/* average bytes per input line, used to size the vector from the file size */
+#define AVG_LINE_LEN 14
+
+/* initial size when the input size is not known (stdin, pipes) */
+#define DEFAULT_VECTOR_SIZE 65536
+
+/* largest initial size from the file size estimate (4 MB), doubling takes it from there */
+#define MAX_INITIAL_VECTOR_SIZE (1024 * 1024)
+
+/* initial size of the CIDR range vector */
+#define DEFAULT_RANGE_VECTOR_SIZE 64
+
+/* xmalloc_() and xrealloc_() take an int byte count */
+#define MAX_VECTOR_SIZE ((size_t)INT_MAX / sizeof(uint32_t))
+
+/****
+ *
+ * typedefs & structs
+ *
+ ****/
+
+struct ipv4Range_s
+{
+  uint32_t start;
+  uint32_t end;
+};
+
+struct addrVector_s
+{
+  uint32_t *list;
+  size_t count;
+  size_t size;
+  size_t maxSize;
+};
+
+struct rangeVector_s
+{
+  struct ipv4Range_s *list;
+  size_t count;
+  size_t size;
+};
+
+struct cidr_s
+{
+  uint32_t network;
+  uint32_t mask;
+};
+
+struct cidrVector_s
+{
+  struct cidr_s *list;
+  size_t count;
+  size_t size;
+};
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+int initAddrVector(struct addrVector_s *vec, off_t inputSize, size_t maxSize);
+int growAddrVector(struct addrVector_s *vec, size_t minSize);
+void shrinkAddrVector(struct addrVector_s *vec);
+void freeAddrVector(struct addrVector_s *vec);
+int addRangeVector(struct rangeVector_s *vec, uint32_t start, uint32_t end);
+void freeRangeVector(struct rangeVector_s *vec);
+int addCidrVector(struct cidrVector_s *vec, uint32_t network, uint32_t mask);
+void freeCidrVector(struct cidrVector_s *vec);
+
+#endif /* VECTOR_DOT_H */
@@ -0,0 +1,42 @@
+#!/bin/sh
+#
+# desc: loader formats must not trip over repeated CIDRs
+#
+# a CIDR given twice, or in two input files, has to come out as an ipset
+# add that tolerates an existing entry and as a single nft element.
+#
+####
+
+IP2CIDR=${IP2CIDR:-../src/ip2cidr}
+TMPDIR=${TMPDIR:-/tmp}
+IN1=$TMPDIR/ip2cidr-loader-1.$$
+IN2=$TMPDIR/ip2cidr-loader-2.$$
+OUT=$TMPDIR/ip2cidr-loader-out.$$
+ret=0
+
+trap 'rm -f $IN1 $IN2 $OUT' 0
+
+printf '10.0.0.0/8\n10.0.0.0/8\n192.168.1.0/24\n' > $IN1
+printf '10.0.0.0/8\n192.168.1.0/24\n172.16.0.0/12\n' > $IN2
+
+# every ipset add carries -exist
+$IP2CIDR -f ipset $IN1 $IN2 > $OUT || exit 1
+if grep '^add ' $OUT | grep -v -- ' -exist$' > /dev/null; then
+  echo "FAIL: ipset add without -exist"
+  ret=1
+fi
+
+# no nft element is written twice, from one file or from two
+for files in "$IN1" "$IN1 $IN2"; do
+  $IP2CIDR -f nft $files > $OUT || exit 1
+  if [ -n "`grep '^	' $OUT | sort | uniq -d`" ]; then
+    echo "FAIL: repeated nft element from $files"
+    ret=1
+  fi
+  if [ `grep -c '^	10.0.0.0/8,' $OUT` -ne 1 ]; then
+    echo "FAIL: 10.0.0.0/8 missing from nft output of $files"
+    ret=1
+  fi
+done
+
+exit $ret